@@ -0,0 +1,224 @@
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "arena.hh"
+#include "bench.hh"
+#include "parser.hh"
+
+// Expression storage: the flat node pool of node::Expr against the pointer
+// tree the parser built before, with one arena object per node, per binary
+// operation and per operator, all behind std::variant. Then the arena use
+// and the parse time of a synthetic program with many scopes.
+
+namespace {
+constexpr size_t operation_count = 2'000'000;
+constexpr int runs = 5;
+
+namespace pointer {
+struct Expr;
+
+struct IntLit {
+    int64_t value;
+};
+
+struct Ident {
+    SymbolId symbol;
+};
+
+struct Term {
+    std::variant<IntLit*, Ident*> var;
+};
+
+struct Operation {
+    Expr* left;
+    Expr* right;
+};
+
+struct Add : Operation {};
+struct Sub : Operation {};
+struct Mul : Operation {};
+struct Div : Operation {};
+
+struct BinExpr {
+    std::variant<Add*, Sub*, Mul*, Div*> var;
+};
+
+struct Expr {
+    std::variant<Term*, BinExpr*> var;
+};
+
+template <typename Operator>
+Expr* binary(ArenaAllocator& arena, Expr* left, Expr* right) {
+    return arena.emplace<Expr>(
+        arena.emplace<BinExpr>(arena.emplace<Operator>(left, right)));
+}
+
+template <typename Leaf>
+Expr* term(ArenaAllocator& arena, Leaf leaf) {
+    return arena.emplace<Expr>(arena.emplace<Term>(arena.emplace<Leaf>(leaf)));
+}
+
+// Left-deep chain `((1 + x) - 2) * x ...`, as the old parser built it
+Expr* build(ArenaAllocator& arena) {
+    Expr* root = term(arena, IntLit{1});
+    for (size_t i = 0; i < operation_count; i++) {
+        Expr* right = i % 2 == 0
+                          ? term(arena, Ident{static_cast<SymbolId>(i)})
+                          : term(arena, IntLit{static_cast<int64_t>(i)});
+        switch (i % 4) {
+            case 0:
+                root = binary<Add>(arena, root, right);
+                break;
+            case 1:
+                root = binary<Sub>(arena, root, right);
+                break;
+            case 2:
+                root = binary<Mul>(arena, root, right);
+                break;
+            default:
+                root = binary<Div>(arena, root, right);
+                break;
+        }
+    }
+    return root;
+}
+
+// Sum of the literals, visiting every node through an explicit stack
+int64_t walk(Expr* root, std::vector<Expr*>& stack) {
+    int64_t sum = 0;
+    stack.push_back(root);
+    while (!stack.empty()) {
+        const Expr* expression = stack.back();
+        stack.pop_back();
+        if (const auto term = std::get_if<Term*>(&expression->var)) {
+            if (const auto literal = std::get_if<IntLit*>(&(*term)->var)) {
+                sum += (*literal)->value;
+            }
+            continue;
+        }
+
+        const Operation* operation = std::visit(
+            [](const auto* binary) -> const Operation* { return binary; },
+            std::get<BinExpr*>(expression->var)->var);
+        stack.push_back(operation->right);
+        stack.push_back(operation->left);
+    }
+    return sum;
+}
+}  // namespace pointer
+
+namespace pool {
+node::ExprId build(NodePool<node::Expr>& expressions) {
+    node::ExprId root = expressions.push_back(node::Expr::int_lit(1, 0));
+    for (size_t i = 0; i < operation_count; i++) {
+        const node::ExprId right = expressions.push_back(
+            i % 2 == 0
+                ? node::Expr::ident(static_cast<SymbolId>(i), 0)
+                : node::Expr::int_lit(static_cast<int64_t>(i), 0));
+        constexpr node::ExprKind kinds[] = {
+            node::ExprKind::Add, node::ExprKind::Sub, node::ExprKind::Mul,
+            node::ExprKind::Div};
+        root = expressions.push_back(
+            node::Expr::binary(kinds[i % 4], root, right, 0));
+    }
+    return root;
+}
+
+int64_t walk(const NodePool<node::Expr>& expressions, const node::ExprId root,
+             std::vector<node::ExprId>& stack) {
+    int64_t sum = 0;
+    stack.push_back(root);
+    while (!stack.empty()) {
+        const node::Expr& expression = expressions[stack.back()];
+        stack.pop_back();
+        if (expression.kind == node::ExprKind::IntLit) {
+            sum += expression.value;
+        } else if (expression.kind != node::ExprKind::Ident) {
+            stack.push_back(expression.operands.right);
+            stack.push_back(expression.operands.left);
+        }
+    }
+    return sum;
+}
+}  // namespace pool
+
+void compare_storage() {
+    size_t pointer_bytes = 0;
+    const double pointer_build = bench::best_of(runs, [&] {
+        ArenaAllocator arena(1024 * 64);
+        bench::keep(pointer::build(arena));
+        pointer_bytes = arena.stats().bytes_used;
+    });
+    ArenaAllocator pointer_arena(1024 * 64);
+    pointer::Expr* pointer_root = pointer::build(pointer_arena);
+    std::vector<pointer::Expr*> pointer_stack;
+    const double pointer_walk = bench::best_of(runs, [&] {
+        bench::keep(pointer::walk(pointer_root, pointer_stack));
+    });
+
+    size_t pool_bytes = 0;
+    const double pool_build = bench::best_of(runs, [&] {
+        ArenaAllocator arena(1024 * 64);
+        NodePool<node::Expr> expressions(arena);
+        bench::keep(pool::build(expressions));
+        pool_bytes = arena.stats().bytes_used;
+    });
+    ArenaAllocator pool_arena(1024 * 64);
+    NodePool<node::Expr> expressions(pool_arena);
+    const node::ExprId pool_root = pool::build(expressions);
+    std::vector<node::ExprId> pool_stack;
+    const double pool_walk = bench::best_of(runs, [&] {
+        bench::keep(pool::walk(expressions, pool_root, pool_stack));
+    });
+
+    bench::report("pointer tree: build", pointer_build);
+    bench::report("pointer tree: walk", pointer_walk);
+    bench::report("node pool: build", pool_build);
+    bench::report("node pool: walk", pool_walk);
+    std::printf("arena bytes: pointer tree %zu, node pool %zu\n",
+                pointer_bytes, pool_bytes);
+}
+
+// Scopes of lets, prints and arithmetic, about 16 MB of source
+std::string scopes_program() {
+    std::string src;
+    for (int scope = 0; scope < 20'000; scope++) {
+        src += "{\n    let x = 1 + 2 * 3;\n";
+        for (int line = 0; line < 10; line++) {
+            src += "    let y" + std::to_string(line) +
+                   " = (x + 7) * (x - 3) / 2 + x * x - 21 + x;\n";
+            src += "    print(y" + std::to_string(line) + " * 2 + x);\n";
+        }
+        src += "}\n";
+    }
+    return src;
+}
+
+void parse_scopes() {
+    const std::string src = scopes_program();
+    ArenaAllocator::Stats stats{};
+    size_t expression_count = 0;
+    const double parse = bench::best_of(runs, [&] {
+        Interner interner;
+        Parser parser(Tokenizer(src, interner));
+        const std::optional<node::Prog> prog = parser.parse_prog();
+        expression_count = prog->expressions.size();
+        stats = parser.arena_stats();
+    });
+
+    bench::report("parse 20k scopes", parse);
+    std::printf(
+        "source %zu bytes, %zu expression nodes, arena %zu bytes used, %zu "
+        "reserved\n",
+        src.size(), expression_count, stats.bytes_used, stats.bytes_reserved);
+}
+}  // namespace
+
+int main() {
+    compare_storage();
+    parse_scopes();
+    return 0;
+}
\ No newline at end of file
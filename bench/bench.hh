@@ -0,0 +1,39 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <limits>
+
+// Helpers shared by the benchmarks in bench/. They are built with the
+// compiler, hack/bench.sh builds them optimized and runs them all.
+namespace bench {
+
+/**
+ * @brief Best wall time of `runs` calls of `body`, in milliseconds
+ */
+template <typename Body>
+double best_of(const int runs, Body&& body) {
+    double best = std::numeric_limits<double>::max();
+    for (int run = 0; run < runs; run++) {
+        const auto start = std::chrono::steady_clock::now();
+        body();
+        const std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+/**
+ * @brief Keep the optimizer from dropping the computation of `value`
+ */
+template <typename T>
+void keep(const T& value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+inline void report(const char* name, const double milliseconds) {
+    std::printf("%-36s %10.2f ms\n", name, milliseconds);
+}
+}  // namespace bench
\ No newline at end of file
@@ -0,0 +1,62 @@
+#include <cstdio>
+#include <string>
+
+#include "bench.hh"
+#include "parser.hh"
+
+// Parse throughput on flat inputs against the same amount of code nested
+// deeply, which the parser handles with explicit stacks instead of recursion
+
+namespace {
+constexpr int count = 100'000;
+constexpr int runs = 5;
+
+std::string repeat(const std::string_view part, const int times) {
+    std::string result;
+    result.reserve(part.size() * times);
+    for (int i = 0; i < times; i++) {
+        result += part;
+    }
+    return result;
+}
+
+struct Shape {
+    const char* name;
+    std::string src;
+};
+
+void measure(const Shape& shape) {
+    bool parsed = false;
+    const double milliseconds = bench::best_of(runs, [&] {
+        Interner interner;
+        Parser parser(Tokenizer(shape.src, interner));
+        parsed = parser.parse_prog().has_value();
+    });
+    if (!parsed) {
+        std::printf("%s: failed to parse\n", shape.name);
+        return;
+    }
+
+    std::printf("%-36s %10.2f ms %8.1f MB/s\n", shape.name, milliseconds,
+                shape.src.size() / 1e3 / milliseconds);
+}
+}  // namespace
+
+int main() {
+    const Shape shapes[] = {
+        {"flat_expr", "exit(1" + repeat(" + 1", count) + ");\n"},
+        {"deep_paren",
+         "exit(" + repeat("(1 + ", count) + "1" + repeat(")", count) + ");\n"},
+        {"flat_scope", "let x = 0;\n" + repeat("{ x = 1; }\n", count)},
+        {"deep_scope",
+         "let x = 0;\n" + repeat("{ x = 1;\n", count) + repeat("}\n", count)},
+        {"flat_if", "let x = 0;\n" + repeat("if (x) { x = 1; }\n", count)},
+        {"deep_if",
+         "let x = 0;\n" + repeat("if (x) { x = 1;\n", count) +
+             repeat("}\n", count)},
+    };
+    for (const Shape& shape : shapes) {
+        measure(shape);
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,9 @@
+#!/bin/bash
+
+cmake -S . -B _bench -DCMAKE_BUILD_TYPE=Release
+cmake --build _bench
+
+for benchmark in _bench/*_bench; do
+    echo "-----$(basename "$benchmark")-----"
+    "$benchmark"
+done
\ No newline at end of file
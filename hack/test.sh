@@ -2,6 +2,7 @@
 
 cmake -S . -B _build -DCMAKE_BUILD_TYPE=Debug
 cmake --build _build
+ctest --test-dir _build --output-on-failure || exit 1
 
 ./_build/cmm input.cm
 
@@ -1,62 +1,338 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
+/**
+ * @brief Bump allocator over a list of chunks
+ *
+ * When a chunk is full, the next one is allocated with twice the size (up to
+ * max_chunk_size), so objects never move once they are placed. Objects that
+ * are not trivially destructible register their destructor, which runs when
+ * the arena is reset, rewound past them or destroyed. Trivially destructible
+ * objects (most AST nodes) cost nothing beyond their size.
+ */
 class ArenaAllocator {
    public:
-    explicit ArenaAllocator(const size_t max_num_bytes)
-        : m_size{max_num_bytes},
-          m_buffer{new std::byte[max_num_bytes]},
-          m_offset{m_buffer} {}
+    // Growth of the chunk size stops here, larger objects still get a chunk
+    // of their own size
+    static constexpr size_t max_chunk_size = 1024 * 1024 * 64;  // 64 mb
+
+    struct Stats {
+        size_t bytes_used;      // Bytes handed out to objects
+        size_t bytes_reserved;  // Total size of all chunks
+        size_t padding;         // Bytes lost to alignment
+        size_t chunks;
+    };
+
+    // Registered destructor of a non-trivially destructible object, the
+    // registry is a list through the arena itself
+    struct Destructor {
+        void (*destroy)(void*);
+        void* object;
+        Destructor* next;  // Registered before this one
+    };
+
+    // Position in the arena to rewind to, see mark() and rewind()
+    struct Mark {
+        size_t chunk;
+        size_t offset;
+        Destructor* destructors;
+        size_t bytes_used;
+        size_t padding;
+    };
+
+    explicit ArenaAllocator(const size_t first_chunk_size)
+        : m_next_chunk_size{first_chunk_size} {
+        // Enough for the chunks of most programs, so that growing the arena
+        // is one allocation
+        m_chunks.reserve(16);
+        add_chunk(0, first_chunk_size);
+    }
 
     ArenaAllocator(const ArenaAllocator&) = delete;
     ArenaAllocator& operator=(const ArenaAllocator&) = delete;
 
     ArenaAllocator(ArenaAllocator&& other) noexcept
-        : m_size{std::exchange(other.m_size, 0)},
-          m_buffer{std::exchange(other.m_buffer, nullptr)},
-          m_offset{std::exchange(other.m_offset, nullptr)} {}
+        : m_chunks{std::move(other.m_chunks)},
+          m_chunk{std::exchange(other.m_chunk, 0)},
+          m_offset{std::exchange(other.m_offset, 0)},
+          m_next_chunk_size{other.m_next_chunk_size},
+          m_destructors{std::exchange(other.m_destructors, nullptr)},
+          m_bytes_used{std::exchange(other.m_bytes_used, 0)},
+          m_padding{std::exchange(other.m_padding, 0)} {
+        other.m_chunks.clear();
+    }
 
     ArenaAllocator& operator=(ArenaAllocator&& other) noexcept {
-        std::swap(m_size, other.m_size);
-        std::swap(m_buffer, other.m_buffer);
+        std::swap(m_chunks, other.m_chunks);
+        std::swap(m_chunk, other.m_chunk);
         std::swap(m_offset, other.m_offset);
+        std::swap(m_next_chunk_size, other.m_next_chunk_size);
+        std::swap(m_destructors, other.m_destructors);
+        std::swap(m_bytes_used, other.m_bytes_used);
+        std::swap(m_padding, other.m_padding);
         return *this;
     }
 
     template <typename T, typename... Args>
     [[nodiscard]] T* emplace(Args&&... args) {
         const auto allocated_memory = alloc<T>();
-        return new (allocated_memory) T{std::forward<Args>(args)...};
+        T* object = new (allocated_memory) T{std::forward<Args>(args)...};
+
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            const auto destroy = [](void* pointer) {
+                static_cast<T*>(pointer)->~T();
+            };
+            m_destructors = new (alloc<Destructor>())
+                Destructor{destroy, object, m_destructors};
+        }
+
+        return object;
+    }
+
+    /**
+     * @brief Uninitialized storage for `count` objects of type T
+     */
+    template <typename T>
+    [[nodiscard]] T* alloc_array(const size_t count) {
+        static_assert(std::is_trivially_destructible_v<T>);
+        return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    /**
+     * @brief Copy `items` into one contiguous array in the arena
+     */
+    template <typename T>
+    [[nodiscard]] std::span<T> copy_array(const std::span<const T> items) {
+        static_assert(std::is_trivially_copyable_v<T> &&
+                      std::is_trivially_destructible_v<T>);
+        if (items.empty()) {
+            return {};
+        }
+
+        T* array = alloc_array<T>(items.size());
+        std::uninitialized_copy(items.begin(), items.end(), array);
+        return {array, items.size()};
+    }
+
+    [[nodiscard]] Mark mark() const {
+        return {m_chunk, m_offset, m_destructors, m_bytes_used, m_padding};
+    }
+
+    /**
+     * @brief Destroy everything allocated since `mark` was taken. The chunks
+     * are kept and reused by the following allocations.
+     */
+    void rewind(const Mark& mark) {
+        while (m_destructors != mark.destructors) {
+            Destructor* destructor = m_destructors;
+            m_destructors = destructor->next;
+            destructor->destroy(destructor->object);
+        }
+
+        m_chunk = mark.chunk;
+        m_offset = mark.offset;
+        m_bytes_used = mark.bytes_used;
+        m_padding = mark.padding;
+    }
+
+    /**
+     * @brief Destroy everything in the arena, keeping the chunks for reuse
+     */
+    void reset() { rewind(Mark{0, 0, nullptr, 0, 0}); }
+
+    [[nodiscard]] Stats stats() const {
+        size_t bytes_reserved = 0;
+        for (const Chunk& chunk : m_chunks) {
+            bytes_reserved += chunk.size;
+        }
+
+        return {m_bytes_used, bytes_reserved, m_padding, m_chunks.size()};
     }
 
     ~ArenaAllocator() {
-        // No destructors are called for the stored objects. Thus, memory
-        // leaks are possible (e.g. when storing std::vector objects or
-        // other non-trivially destructable objects in the allocator).
-        // Although this could be changed, it would come with additional
-        // runtime overhead and therefore is not implemented.
-        delete[] m_buffer;
+        reset();
+        for (const Chunk& chunk : m_chunks) {
+            delete[] chunk.buffer;
+        }
     }
 
    private:
+    struct Chunk {
+        std::byte* buffer;
+        size_t size;
+    };
+
     template <typename T>
     [[nodiscard]] T* alloc() {
-        size_t remaining_num_bytes =
-            m_size - static_cast<size_t>(m_offset - m_buffer);
-        auto pointer = static_cast<void*>(m_offset);
-        const auto aligned_address =
-            std::align(alignof(T), sizeof(T), pointer, remaining_num_bytes);
-        if (aligned_address == nullptr) {
-            throw std::bad_alloc{};
+        return static_cast<T*>(allocate(sizeof(T), alignof(T)));
+    }
+
+    [[nodiscard]] void* allocate(const size_t size, const size_t alignment) {
+        while (true) {
+            const Chunk& chunk = m_chunks[m_chunk];
+            size_t remaining_num_bytes = chunk.size - m_offset;
+            auto pointer = static_cast<void*>(chunk.buffer + m_offset);
+            const auto aligned_address =
+                std::align(alignment, size, pointer, remaining_num_bytes);
+            if (aligned_address != nullptr) {
+                const auto start = static_cast<size_t>(
+                    static_cast<std::byte*>(aligned_address) - chunk.buffer);
+                m_padding += start - m_offset;
+                m_bytes_used += size;
+                m_offset = start + size;
+                return aligned_address;
+            }
+
+            next_chunk(size + alignment);
         }
-        m_offset = static_cast<std::byte*>(aligned_address) + sizeof(T);
-        return static_cast<T*>(aligned_address);
     }
 
-    size_t m_size;
-    std::byte* m_buffer;
-    std::byte* m_offset;
+    // Move on to the next chunk that can hold `min_size` bytes
+    void next_chunk(const size_t min_size) {
+        m_chunk++;
+        m_offset = 0;
+
+        // Chunks left over from before a rewind are reused
+        if (m_chunk < m_chunks.size() && m_chunks[m_chunk].size >= min_size) {
+            return;
+        }
+
+        add_chunk(m_chunk, std::max(m_next_chunk_size, min_size));
+        m_next_chunk_size = std::min(m_next_chunk_size * 2, max_chunk_size);
+    }
+
+    void add_chunk(const size_t index, const size_t size) {
+        m_chunks.insert(m_chunks.begin() + static_cast<ptrdiff_t>(index),
+                        Chunk{new std::byte[size], size});
+    }
+
+    std::vector<Chunk> m_chunks;
+    size_t m_chunk{0};   // Chunk allocations are currently made from
+    size_t m_offset{0};  // Offset of the free space in the current chunk
+    size_t m_next_chunk_size;
+    Destructor* m_destructors{nullptr};  // Last registered destructor
+
+    size_t m_bytes_used{0};
+    size_t m_padding{0};
+};
+
+/**
+ * @brief Append-only array of trivially destructible nodes in an arena,
+ * addressed by 32-bit index instead of pointer
+ *
+ * The nodes are stored in segments that double in size, the first holding
+ * 2^first_segment_bits nodes. Nodes never move, and finding the segment of
+ * an index is a single bit scan.
+ */
+template <typename T>
+class NodePool {
+   public:
+    using Id = uint32_t;
+
+    static constexpr size_t first_segment_bits = 8;  // 256 nodes
+
+    explicit NodePool(ArenaAllocator& allocator) : m_allocator{&allocator} {
+        static_assert(std::is_trivially_copyable_v<T> &&
+                      std::is_trivially_destructible_v<T>);
+    }
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    NodePool(NodePool&& other) noexcept
+        : m_allocator{other.m_allocator},
+          m_segments{std::exchange(other.m_segments, {})},
+          m_size{std::exchange(other.m_size, 0)} {}
+
+    NodePool& operator=(NodePool&& other) noexcept {
+        std::swap(m_allocator, other.m_allocator);
+        std::swap(m_segments, other.m_segments);
+        std::swap(m_size, other.m_size);
+        return *this;
+    }
+
+    Id push_back(const T& node) {
+        const auto [segment, slot] = locate(m_size);
+        if (slot == 0) {
+            m_segments[segment] = m_allocator->alloc_array<T>(
+                size_t{1} << (first_segment_bits + segment));
+        }
+
+        m_segments[segment][slot] = node;
+        return m_size++;
+    }
+
+    [[nodiscard]] T& operator[](const Id id) {
+        const auto [segment, slot] = locate(id);
+        return m_segments[segment][slot];
+    }
+
+    [[nodiscard]] const T& operator[](const Id id) const {
+        const auto [segment, slot] = locate(id);
+        return m_segments[segment][slot];
+    }
+
+    [[nodiscard]] size_t size() const { return m_size; }
+
+   private:
+    struct Location {
+        size_t segment;
+        size_t slot;
+    };
+
+    // Segment k holds the indices [2^b * (2^k - 1), 2^b * (2^(k+1) - 1)),
+    // so index + 2^b has its highest bit at b + k
+    static Location locate(const Id id) {
+        constexpr uint64_t first_segment_size = uint64_t{1}
+                                                << first_segment_bits;
+        const uint64_t biased = id + first_segment_size;
+        const auto segment = static_cast<size_t>(std::bit_width(biased)) - 1 -
+                             first_segment_bits;
+        return {segment,
+                static_cast<size_t>(biased - (first_segment_size << segment))};
+    }
+
+    ArenaAllocator* m_allocator;
+    std::array<T*, 33 - first_segment_bits> m_segments{};
+    Id m_size{0};
+};
+
+/**
+ * @brief Standard allocator handing out memory from an arena, for scratch
+ * containers that live as long as the arena
+ *
+ * Memory only comes back when the arena is reset, so a growing vector leaves
+ * its previous arrays behind, which adds up to less than its largest size.
+ */
+template <typename T>
+struct ArenaStlAllocator {
+    using value_type = T;
+
+    explicit ArenaStlAllocator(ArenaAllocator& allocator)
+        : allocator{&allocator} {}
+
+    template <typename U>
+    explicit ArenaStlAllocator(const ArenaStlAllocator<U>& other)
+        : allocator{other.allocator} {}
+
+    [[nodiscard]] T* allocate(const size_t count) {
+        return allocator->alloc_array<T>(count);
+    }
+
+    void deallocate(T*, size_t) {}
+
+    bool operator==(const ArenaStlAllocator& other) const = default;
+
+    ArenaAllocator* allocator;
 };
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include "cmm.hh"
+
+#include "cse.hh"
+#include "dead_branch.hh"
+#include "dead_store.hh"
+#include "fold.hh"
+#include "generation.hh"
+#include "interner.hh"
+#include "lower.hh"
+#include "parser.hh"
+#include "pass_manager.hh"
+#include "print_text.hh"
+#include "propagate.hh"
+#include "sccp.hh"
+#include "semantic.hh"
+#include "simplify_cfg.hh"
+#include "ssa.hh"
+#include "tokenization.hh"
+
+namespace cmm {
+
+Result compile(const std::string_view src, const Options& options) {
+    Result result;
+    try {
+        // Identifiers are interned while lexing, the semantic pass only needs
+        // their names for diagnostics
+        Interner interner;
+        Tokenizer tokenizer(src, interner,
+                            options.isa.value_or(scan::best_isa()));
+#ifdef DEBUG
+        // Dump the whole token stream, the parser pulls the tokens on its own
+        tokenizer.tokenize();
+#endif
+
+        Parser parser(std::move(tokenizer));
+        std::optional<node::Prog> prog = parser.parse_prog();
+        if (!prog.has_value()) {
+            ErrorManager::error(ErrorCode::InvalidProgram);
+        }
+
+        SemanticAnalyzer(prog.value(), src, interner).analyze();
+        ConstantFolder(prog.value(), src).fold();
+        ConstantPropagator(prog.value()).propagate();
+        DeadBranchEliminator(prog.value(), parser.allocator()).eliminate();
+        DeadStoreEliminator(prog.value()).eliminate();
+        CommonSubexprEliminator(prog.value(), parser.allocator()).eliminate();
+
+        ir::Program program = Lowering(prog.value()).lower();
+
+        PassManager passes;
+        passes.add("ssa",
+                   [](ir::Program& program) { SsaBuilder(program).build(); });
+        passes.add("sccp", [](ir::Program& program) {
+            SparseConditionalPropagator(program).propagate();
+        });
+        passes.add("out-of-ssa", [](ir::Program& program) {
+            SsaDestructor(program).destruct();
+        });
+        passes.add("simplify-cfg", [](ir::Program& program) {
+            CfgSimplifier(program).simplify();
+        });
+        passes.add("print-text", [](ir::Program& program) {
+            PrintTextCombiner(program).combine();
+        });
+        for (const std::string& spec : options.dump_ir) {
+            passes.dump(spec);
+        }
+        passes.run(program);
+        result.ir_dump = passes.dumps();
+        result.pass_timings = passes.timings();
+
+        Generator generator(std::move(program));
+        result.assembly = generator.gen_prog();
+    } catch (const CompileError& error) {
+        result.diagnostics.push_back(
+            Diagnostic{error.code, error.line, error.column, error.message});
+    }
+
+    return result;
+}
+}  // namespace cmm
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "error.hh"
+#include "pass_manager.hh"
+#include "scan.hh"
+
+// In-process compiler API. Errors are reported as values, compile() never
+// exits the process, and it keeps no state between calls, so it may be called
+// repeatedly and from several threads at once.
+namespace cmm {
+
+struct Options {
+    // Instruction set of the lexer's scan kernels, the widest one the CPU
+    // supports if empty
+    std::optional<scan::Isa> isa;
+    // Where to dump the IR, as `after:<pass>` or `after:all`
+    std::vector<std::string> dump_ir;
+};
+
+struct Diagnostic {
+    ErrorCode code;
+    size_t line;          // Starting at 1, 0 if the error has no location
+    size_t column;        // Starting at 1, 0 if the error has no location
+    std::string message;  // As printed by the command line compiler
+};
+
+struct Result {
+    std::string assembly;  // Empty if there are diagnostics
+    std::vector<Diagnostic> diagnostics;
+    std::string ir_dump;                   // As requested by Options::dump_ir
+    std::vector<PassTiming> pass_timings;  // Of the IR passes, in order
+
+    [[nodiscard]] bool ok() const { return diagnostics.empty(); }
+};
+
+/**
+ * @brief Compile the program `src` to nasm x86-64 assembly
+ */
+Result compile(std::string_view src, const Options& options = {});
+}  // namespace cmm
\ No newline at end of file
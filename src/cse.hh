@@ -0,0 +1,319 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include "arena.hh"
+#include "parser.hh"
+
+/**
+ * @brief Computes every subexpression that occurs more than once in a
+ * straight-line region only once, runs last before code generation
+ *
+ * A region is a run of statements of one scope up to a nested scope or an if
+ * statement; the condition of the if still belongs to the region, its elif
+ * conditions do not, as they are not always evaluated. Subexpressions are
+ * value numbered: literals by value, reads by variable and version, and
+ * operations by operator and operand numbers, ordered for + and *. An
+ * assignment gives its variable a new version, so nothing computed from the
+ * old value is reused afterwards.
+ *
+ * The first occurrence of a repeated operation moves into a new immutable
+ * temporary declared right before its statement, and every occurrence becomes
+ * a read of it. When the repeated operation is already the initializer of an
+ * immutable let, that variable is reused instead. The moved operation is
+ * appended to the pool, so operands still precede the expressions using them,
+ * but initializers no longer precede the reads of their variables.
+ */
+class CommonSubexprEliminator {
+   public:
+    CommonSubexprEliminator(node::Prog& prog, ArenaAllocator& allocator)
+        : m_prog(prog),
+          m_allocator(allocator),
+          m_versions(prog.variable_count, 0),
+          m_value_numbers(prog.expressions.size()) {}
+
+    void eliminate() {
+        m_prog.statements = eliminate_in(m_prog.statements);
+    }
+
+   private:
+    using ValueNumber = uint32_t;
+
+    // Symbol of the temporaries, which have no name
+    static constexpr SymbolId no_symbol = std::numeric_limits<SymbolId>::max();
+
+    struct ValueKey {
+        node::ExprKind kind;
+        uint64_t first;   // Value, variable or left operand
+        uint64_t second;  // Version or right operand
+
+        bool operator==(const ValueKey&) const = default;
+    };
+
+    struct ValueKeyHash {
+        size_t operator()(const ValueKey& key) const {
+            uint64_t hash = static_cast<uint64_t>(key.kind);
+            hash = (hash ^ key.first) * 0x9e3779b97f4a7c15;
+            hash = (hash ^ key.second) * 0x9e3779b97f4a7c15;
+            return static_cast<size_t>(hash ^ (hash >> 32));
+        }
+    };
+
+    struct Frame {
+        node::ExprId id;
+        bool operands_done;
+    };
+
+    /**
+     * @brief Eliminate the common subexpressions of `statements`, returns the
+     * statements with the temporaries inserted
+     */
+    std::span<node::Stmt*> eliminate_in(
+        const std::span<node::Stmt*> statements) {
+        const size_t base = m_statements.size();
+        size_t region = 0;
+        for (size_t i = 0; i < statements.size(); i++) {
+            node::Stmt* statement = statements[i];
+            if (const auto scope = std::get_if<node::Scope*>(&statement->var)) {
+                eliminate_region(statements.subspan(region, i - region));
+                m_statements.push_back(statement);
+                (*scope)->statements = eliminate_in((*scope)->statements);
+                region = i + 1;
+            } else if (const auto stmt_if =
+                           std::get_if<node::StmtIf*>(&statement->var)) {
+                eliminate_region(statements.subspan(region, i + 1 - region));
+                eliminate_in((*stmt_if)->if_branch->scope);
+                for (node::ElifBranch* elif_branch :
+                     (*stmt_if)->elif_branches) {
+                    eliminate_in(elif_branch->scope);
+                }
+                if ((*stmt_if)->else_branch.has_value()) {
+                    eliminate_in((*stmt_if)->else_branch.value()->scope);
+                }
+                region = i + 1;
+            }
+        }
+        eliminate_region(statements.subspan(region));
+
+        // Without temporaries, the statements are the same as before
+        std::span<node::Stmt*> result = statements;
+        if (m_statements.size() - base != statements.size()) {
+            result = m_allocator.copy_array<node::Stmt*>(
+                std::span<node::Stmt* const>{m_statements}.subspan(base));
+        }
+        m_statements.resize(base);
+        return result;
+    }
+
+    void eliminate_in(node::Scope* scope) {
+        scope->statements = eliminate_in(scope->statements);
+    }
+
+    // Number and count the expressions of `region`, then replace the
+    // repeated ones, pushing the statements to m_statements
+    void eliminate_region(const std::span<node::Stmt*> region) {
+        // Clearing costs the bucket count, a table grown for a large region
+        // is dropped rather than cleared for every small one after it
+        if (m_value_table.bucket_count() > 4 * m_value_table.size() + 64) {
+            m_value_table = {};
+        } else {
+            m_value_table.clear();
+        }
+        m_counts.clear();
+        m_temporaries.clear();
+
+        for (const node::Stmt* statement : region) {
+            for_each_root(statement, [&](const node::ExprId root) {
+                number(root);
+                count(root);
+            });
+            if (const auto statement_assign =
+                    std::get_if<node::StmtAssign*>(&statement->var)) {
+                m_versions[(*statement_assign)->var]++;
+            }
+        }
+
+        for (node::Stmt* statement : region) {
+            node::VarId holder = node::unresolved_var;
+            if (const auto statement_let =
+                    std::get_if<node::StmtLet*>(&statement->var)) {
+                if (!(*statement_let)->is_mutable) {
+                    holder = (*statement_let)->var;
+                }
+            }
+
+            for_each_root(statement, [&](const node::ExprId root) {
+                replace(root, holder);
+            });
+            m_statements.push_back(statement);
+        }
+    }
+
+    // Call `visit` with the expressions `statement` evaluates in its region
+    template <typename Visit>
+    static void for_each_root(const node::Stmt* statement, Visit visit) {
+        if (const auto statement_exit =
+                std::get_if<node::StmtExit*>(&statement->var)) {
+            visit((*statement_exit)->expression);
+        } else if (const auto statement_print =
+                       std::get_if<node::StmtArg*>(&statement->var)) {
+            if (const auto expression =
+                    std::get_if<node::ExprId>(&(*statement_print)->var)) {
+                visit(*expression);
+            }
+        } else if (const auto statement_let =
+                       std::get_if<node::StmtLet*>(&statement->var)) {
+            visit((*statement_let)->expression);
+        } else if (const auto statement_assign =
+                       std::get_if<node::StmtAssign*>(&statement->var)) {
+            visit((*statement_assign)->expression);
+        } else if (const auto stmt_if =
+                       std::get_if<node::StmtIf*>(&statement->var)) {
+            visit((*stmt_if)->if_branch->condition);
+        }
+    }
+
+    // Assign value numbers to `root` and its operands, bottom-up
+    void number(const node::ExprId root) {
+        m_frames.push_back({root, false});
+        while (!m_frames.empty()) {
+            const Frame frame = m_frames.back();
+            m_frames.pop_back();
+            const node::Expr& expression = m_prog.expressions[frame.id];
+
+            ValueKey key{expression.kind, 0, 0};
+            switch (expression.kind) {
+                case node::ExprKind::IntLit:
+                    key.first = static_cast<uint64_t>(expression.value);
+                    break;
+                case node::ExprKind::Ident:
+                    key.first = expression.variable.var;
+                    key.second = m_versions[expression.variable.var];
+                    break;
+                case node::ExprKind::Add:
+                case node::ExprKind::Sub:
+                case node::ExprKind::Mul:
+                case node::ExprKind::Div:
+                    if (!frame.operands_done) {
+                        m_frames.push_back({frame.id, true});
+                        m_frames.push_back({expression.operands.left, false});
+                        m_frames.push_back({expression.operands.right, false});
+                        continue;
+                    }
+
+                    key.first = m_value_numbers[expression.operands.left];
+                    key.second = m_value_numbers[expression.operands.right];
+                    if ((expression.kind == node::ExprKind::Add ||
+                         expression.kind == node::ExprKind::Mul) &&
+                        key.first > key.second) {
+                        std::swap(key.first, key.second);
+                    }
+                    break;
+            }
+
+            const auto [entry, inserted] = m_value_table.try_emplace(
+                key, static_cast<ValueNumber>(m_counts.size()));
+            if (inserted) {
+                m_counts.push_back(0);
+                m_temporaries.push_back(node::unresolved_var);
+            }
+            m_value_numbers[frame.id] = entry->second;
+        }
+    }
+
+    // Count the evaluations of the operations in `root` that remain once
+    // every repeated operation is computed once. The operands of a repeated
+    // operation are not counted again.
+    void count(const node::ExprId root) {
+        m_frames.push_back({root, false});
+        while (!m_frames.empty()) {
+            const node::Expr& expression =
+                m_prog.expressions[m_frames.back().id];
+            const ValueNumber value_number =
+                m_value_numbers[m_frames.back().id];
+            m_frames.pop_back();
+
+            if (expression.kind == node::ExprKind::IntLit ||
+                expression.kind == node::ExprKind::Ident) {
+                continue;
+            }
+
+            if (m_counts[value_number]++ == 0) {
+                m_frames.push_back({expression.operands.left, false});
+                m_frames.push_back({expression.operands.right, false});
+            }
+        }
+    }
+
+    /**
+     * @brief Replace the repeated operations in `root` by reads of their
+     * temporaries, declaring a temporary at the first occurrence. `holder`
+     * is the immutable variable `root` initializes, if any.
+     */
+    void replace(const node::ExprId root, const node::VarId holder) {
+        m_frames.push_back({root, false});
+        while (!m_frames.empty()) {
+            const Frame frame = m_frames.back();
+            m_frames.pop_back();
+            node::Expr& expression = m_prog.expressions[frame.id];
+            if (expression.kind == node::ExprKind::IntLit ||
+                expression.kind == node::ExprKind::Ident) {
+                continue;
+            }
+
+            const ValueNumber value_number = m_value_numbers[frame.id];
+            if (!frame.operands_done) {
+                const node::VarId temporary = m_temporaries[value_number];
+                if (temporary != node::unresolved_var) {
+                    expression = read(temporary, expression.offset);
+                    continue;
+                }
+
+                if (m_counts[value_number] > 1) {
+                    m_frames.push_back({frame.id, true});
+                }
+                m_frames.push_back({expression.operands.left, false});
+                m_frames.push_back({expression.operands.right, false});
+                continue;
+            }
+
+            // All operands are replaced, temporaries they need are declared
+            if (frame.id == root && holder != node::unresolved_var) {
+                m_temporaries[value_number] = holder;
+                continue;
+            }
+
+            const node::ExprId moved = m_prog.expressions.push_back(expression);
+            const auto var = static_cast<node::VarId>(m_prog.variable_count++);
+            m_statements.push_back(m_allocator.emplace<node::Stmt>(
+                m_allocator.emplace<node::StmtLet>(
+                    no_symbol, expression.offset, moved, false, var)));
+            m_temporaries[value_number] = var;
+            expression = read(var, expression.offset);
+        }
+    }
+
+    static node::Expr read(const node::VarId var, const uint32_t offset) {
+        node::Expr expression = node::Expr::ident(no_symbol, offset);
+        expression.variable.var = var;
+        return expression;
+    }
+
+    node::Prog& m_prog;
+    ArenaAllocator& m_allocator;  // The parser's, for the new statements
+
+    std::vector<uint32_t> m_versions;  // Assignments so far, by VarId
+    // Indexed by ExprId, valid for the expressions of the current region
+    std::vector<ValueNumber> m_value_numbers;
+    std::unordered_map<ValueKey, ValueNumber, ValueKeyHash> m_value_table;
+    std::vector<uint32_t> m_counts;          // Indexed by ValueNumber
+    std::vector<node::VarId> m_temporaries;  // Indexed by ValueNumber
+    std::vector<Frame> m_frames;
+    // Scratch stack for the statement lists under construction
+    std::vector<node::Stmt*> m_statements;
+};
\ No newline at end of file
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <span>
+#include <variant>
+
+#include "arena.hh"
+#include "parser.hh"
+
+/**
+ * @brief Removes the branches of if/elif/else chains whose conditions are
+ * constant, runs after constant folding
+ *
+ * Branches whose condition is zero are dropped. The first branch whose
+ * condition is a non-zero constant becomes the else branch, and every branch
+ * after it is dropped. A chain that is left with only an else branch becomes
+ * a plain scope, and a chain that is left with nothing is removed. String
+ * literals in the dropped scopes are never emitted.
+ */
+class DeadBranchEliminator {
+   public:
+    DeadBranchEliminator(node::Prog& prog, ArenaAllocator& allocator)
+        : m_prog(prog), m_allocator(allocator) {}
+
+    void eliminate() {
+        m_prog.statements = eliminate_in(m_prog.statements);
+    }
+
+   private:
+    /**
+     * @brief Simplify `statements` in place, returns the statements that are
+     * kept
+     */
+    std::span<node::Stmt*> eliminate_in(
+        const std::span<node::Stmt*> statements) {
+        size_t kept = 0;
+        for (node::Stmt* statement : statements) {
+            const auto stmt_if = std::get_if<node::StmtIf*>(&statement->var);
+            if (stmt_if != nullptr && !simplify_if(statement, *stmt_if)) {
+                continue;
+            }
+
+            if (const auto scope = std::get_if<node::Scope*>(&statement->var)) {
+                eliminate_in(*scope);
+            } else if (const auto stmt_if =
+                           std::get_if<node::StmtIf*>(&statement->var)) {
+                eliminate_in((*stmt_if)->if_branch->scope);
+                for (node::ElifBranch* elif_branch :
+                     (*stmt_if)->elif_branches) {
+                    eliminate_in(elif_branch->scope);
+                }
+                if ((*stmt_if)->else_branch.has_value()) {
+                    eliminate_in((*stmt_if)->else_branch.value()->scope);
+                }
+            }
+
+            statements[kept++] = statement;
+        }
+
+        return statements.first(kept);
+    }
+
+    void eliminate_in(node::Scope* scope) {
+        scope->statements = eliminate_in(scope->statements);
+    }
+
+    /**
+     * @brief Drop the branches of `stmt_if` that are never taken, returns
+     * false if the whole statement goes away
+     */
+    bool simplify_if(node::Stmt* statement, node::StmtIf* stmt_if) {
+        node::IfBranch* if_branch = stmt_if->if_branch;
+        const std::span<node::ElifBranch*> elif_branches =
+            stmt_if->elif_branches;
+
+        // The branches that keep a runtime condition are compacted to the
+        // front: the first one into the if branch, the others into the elifs
+        bool has_condition = false;
+        size_t kept_elifs = 0;
+        node::Scope* tail = nullptr;  // Taken when no condition holds
+        bool reaches_else = true;
+
+        const auto keep_branch = [&](const node::ExprId condition,
+                                     node::Scope* scope,
+                                     node::ElifBranch* elif_branch) {
+            const node::Expr& expression = m_prog.expressions[condition];
+            if (expression.kind == node::ExprKind::IntLit) {
+                if (expression.value != 0) {
+                    tail = scope;
+                    reaches_else = false;
+                }
+                return;
+            }
+
+            if (!has_condition) {
+                if_branch->condition = condition;
+                if_branch->scope = scope;
+                has_condition = true;
+            } else {
+                elif_branches[kept_elifs++] = elif_branch;
+            }
+        };
+
+        keep_branch(if_branch->condition, if_branch->scope, nullptr);
+        for (node::ElifBranch* elif_branch : elif_branches) {
+            if (!reaches_else) break;
+            keep_branch(elif_branch->condition, elif_branch->scope,
+                        elif_branch);
+        }
+        if (reaches_else && stmt_if->else_branch.has_value()) {
+            tail = stmt_if->else_branch.value()->scope;
+        }
+
+        if (!has_condition) {
+            if (tail == nullptr) {
+                return false;
+            }
+
+            statement->var = tail;
+            return true;
+        }
+
+        stmt_if->elif_branches = elif_branches.first(kept_elifs);
+        if (tail == nullptr) {
+            stmt_if->else_branch = std::nullopt;
+        } else if (stmt_if->else_branch.has_value()) {
+            stmt_if->else_branch.value()->scope = tail;
+        } else {
+            node::ElseBranch* else_branch =
+                m_allocator.emplace<node::ElseBranch>();
+            else_branch->scope = tail;
+            stmt_if->else_branch = else_branch;
+        }
+
+        return true;
+    }
+
+    node::Prog& m_prog;
+    ArenaAllocator& m_allocator;  // The parser's, for new else branches
+};
\ No newline at end of file
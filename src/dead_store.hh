@@ -0,0 +1,210 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <variant>
+#include <vector>
+
+#include "parser.hh"
+
+/**
+ * @brief Removes assignments and lets whose value is never read, and lets of
+ * variables that are never used at all, runs after dead branch elimination
+ *
+ * The language has no loops, so liveness is computed in a single backward
+ * walk over the statements: the variables live after an if chain flow into
+ * every branch, and the variables live before it are the union over the
+ * branches and conditions. A store is removed when its variable is not live
+ * after it and its expression cannot trap. Division traps on a zero divisor
+ * and on INT64_MIN / -1, so it is kept unless the divisor is a constant other
+ * than 0 and -1. A let whose value is dead stays when the variable is still
+ * assigned, as the assignment needs its stack slot.
+ */
+class DeadStoreEliminator {
+   public:
+    explicit DeadStoreEliminator(node::Prog& prog)
+        : m_prog(prog),
+          m_live(prog.variable_count),
+          m_used(prog.variable_count, false) {}
+
+    void eliminate() {
+        m_prog.statements = eliminate_in(m_prog.statements);
+    }
+
+   private:
+    // Set of VarIds, one bit each
+    class LiveSet {
+       public:
+        explicit LiveSet(const size_t size) : m_words((size + 63) / 64) {}
+
+        [[nodiscard]] bool contains(const node::VarId var) const {
+            return (m_words[var / 64] >> (var % 64) & 1) != 0;
+        }
+
+        void insert(const node::VarId var) {
+            m_words[var / 64] |= uint64_t{1} << (var % 64);
+        }
+
+        void erase(const node::VarId var) {
+            m_words[var / 64] &= ~(uint64_t{1} << (var % 64));
+        }
+
+        void unite(const LiveSet& other) {
+            for (size_t i = 0; i < m_words.size(); i++) {
+                m_words[i] |= other.m_words[i];
+            }
+        }
+
+        void clear() { std::ranges::fill(m_words, 0); }
+
+       private:
+        std::vector<uint64_t> m_words;
+    };
+
+    /**
+     * @brief Remove the dead stores of `statements` in place, given the
+     * variables live after them in m_live, which becomes the variables live
+     * before them. Returns the statements that are kept.
+     */
+    std::span<node::Stmt*> eliminate_in(
+        const std::span<node::Stmt*> statements) {
+        size_t kept = statements.size();
+        for (size_t i = statements.size(); i-- > 0;) {
+            node::Stmt* statement = statements[i];
+            if (keep(statement)) {
+                statements[--kept] = statement;
+            }
+        }
+
+        return statements.subspan(kept);
+    }
+
+    void eliminate_in(node::Scope* scope) {
+        scope->statements = eliminate_in(scope->statements);
+    }
+
+    // Update m_live for `statement`, returns false if it goes away
+    bool keep(const node::Stmt* statement) {
+        if (const auto statement_exit =
+                std::get_if<node::StmtExit*>(&statement->var)) {
+            // Nothing after an exit is ever executed
+            m_live.clear();
+            read((*statement_exit)->expression);
+        } else if (const auto statement_print =
+                       std::get_if<node::StmtArg*>(&statement->var)) {
+            if (const auto expression =
+                    std::get_if<node::ExprId>(&(*statement_print)->var)) {
+                read(*expression);
+            }
+        } else if (const auto statement_let =
+                       std::get_if<node::StmtLet*>(&statement->var)) {
+            const node::StmtLet* let = *statement_let;
+            if (!m_used[let->var] && !may_trap(let->expression)) {
+                return false;
+            }
+
+            m_live.erase(let->var);
+            read(let->expression);
+        } else if (const auto statement_assign =
+                       std::get_if<node::StmtAssign*>(&statement->var)) {
+            const node::StmtAssign* assign = *statement_assign;
+            if (!m_live.contains(assign->var) &&
+                !may_trap(assign->expression)) {
+                return false;
+            }
+
+            m_used[assign->var] = true;
+            m_live.erase(assign->var);
+            read(assign->expression);
+        } else if (const auto scope =
+                       std::get_if<node::Scope*>(&statement->var)) {
+            eliminate_in(*scope);
+        } else if (const auto stmt_if =
+                       std::get_if<node::StmtIf*>(&statement->var)) {
+            eliminate_if(*stmt_if);
+        }
+
+        return true;
+    }
+
+    void eliminate_if(node::StmtIf* stmt_if) {
+        const LiveSet live_after = m_live;
+        // Without an else branch, control can pass through every condition
+        // straight to the statements after the chain
+        LiveSet live_before = live_after;
+        if (stmt_if->else_branch.has_value()) {
+            eliminate_in(stmt_if->else_branch.value()->scope);
+            live_before = m_live;
+        }
+
+        const auto eliminate_branch = [&](const node::ExprId condition,
+                                          node::Scope* scope) {
+            m_live = live_after;
+            eliminate_in(scope);
+            read(condition);
+            live_before.unite(m_live);
+        };
+
+        for (node::ElifBranch* elif_branch : stmt_if->elif_branches) {
+            eliminate_branch(elif_branch->condition, elif_branch->scope);
+        }
+        eliminate_branch(stmt_if->if_branch->condition,
+                         stmt_if->if_branch->scope);
+
+        m_live = std::move(live_before);
+    }
+
+    // Mark every variable read by `root` as live and used
+    void read(const node::ExprId root) {
+        m_expr_stack.push_back(root);
+        while (!m_expr_stack.empty()) {
+            const node::Expr& expression =
+                m_prog.expressions[m_expr_stack.back()];
+            m_expr_stack.pop_back();
+
+            if (expression.kind == node::ExprKind::Ident) {
+                m_live.insert(expression.variable.var);
+                m_used[expression.variable.var] = true;
+            } else if (expression.kind != node::ExprKind::IntLit) {
+                m_expr_stack.push_back(expression.operands.left);
+                m_expr_stack.push_back(expression.operands.right);
+            }
+        }
+    }
+
+    [[nodiscard]] bool may_trap(const node::ExprId root) {
+        m_expr_stack.push_back(root);
+        while (!m_expr_stack.empty()) {
+            const node::Expr& expression =
+                m_prog.expressions[m_expr_stack.back()];
+            m_expr_stack.pop_back();
+
+            if (expression.kind == node::ExprKind::IntLit ||
+                expression.kind == node::ExprKind::Ident) {
+                continue;
+            }
+
+            if (expression.kind == node::ExprKind::Div) {
+                const node::Expr& divisor =
+                    m_prog.expressions[expression.operands.right];
+                if (divisor.kind != node::ExprKind::IntLit ||
+                    divisor.value == 0 || divisor.value == -1) {
+                    m_expr_stack.clear();
+                    return true;
+                }
+            }
+            m_expr_stack.push_back(expression.operands.left);
+            m_expr_stack.push_back(expression.operands.right);
+        }
+
+        return false;
+    }
+
+    node::Prog& m_prog;
+    LiveSet m_live;  // Variables read before they are next assigned
+    // Variables read or assigned by the statements kept so far, indexed by
+    // VarId
+    std::vector<bool> m_used;
+    std::vector<node::ExprId> m_expr_stack;
+};
\ No newline at end of file
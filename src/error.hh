@@ -1,17 +1,25 @@
 #pragma once
 
+#include <exception>
+#include <sstream>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
+
+#include "source.hh"
 
 enum class ErrorCode {
     // Compiler Errors
     VariableNotDeclared,
     VariableAlreadyDeclared,
     VariableNotMutable,
+    DivisionByZero,
 
     // Syntax Errors
     StringTooLong,
     UnidentifiedToken,
+    UnterminatedString,
 
     ExpectedExpression,
     ExpectedOpenParenthesis,
@@ -20,35 +28,76 @@ enum class ErrorCode {
     ExpectedCloseCurly,
     ExpectedScope,
     ExpectedIntegerLiteral,
+    ExpectedIdentifier,
+    IntegerLiteralOverflow,
     ExpectedEndOfLine,
     UnknownOperator,
 
     // Program Errors
     InvalidProgram,
     InvalidUsage,
+    UnknownPass,
     OpenFileError,
+    SourceTooLarge,
+};
+
+/**
+ * @brief Error raised anywhere in the pipeline, cmm::compile() catches it and
+ * reports it as a diagnostic
+ */
+struct CompileError : std::exception {
+    ErrorCode code;
+    size_t line;    // Starting at 1, 0 if the error has no location
+    size_t column;  // Starting at 1, 0 if the error has no location
+    std::string message;
+
+    CompileError(const ErrorCode code, const size_t line, const size_t column,
+                 std::string message)
+        : code{code}, line{line}, column{column}, message{std::move(message)} {}
+
+    [[nodiscard]] const char* what() const noexcept override {
+        return message.c_str();
+    }
 };
 
 class ErrorManager {
    public:
-    static void error_expected(const ErrorCode error_code,
-                               const size_t line_number,
-                               const size_t column_number) {
-        std::cerr << construct_error_message(error_code, line_number,
-                                             column_number);
-        exit(EXIT_FAILURE);
+    /**
+     * @brief Report an error at `offset` in `src`, `detail` is appended to
+     * the message. The line and the column are only computed here.
+     */
+    [[noreturn]] static void error_expected(
+        const ErrorCode error_code, const std::string_view src,
+        const size_t offset, const std::string_view detail = {}) {
+        const auto location = LineTable(src).locate(offset);
+        throw CompileError{
+            error_code, location.line, location.column,
+            construct_error_message(error_code, location.line,
+                                    location.column, detail)};
+    }
+
+    /**
+     * @brief Report an error without a location, `detail` is appended to the
+     * message
+     */
+    [[noreturn]] static void error(const ErrorCode error_code,
+                                   const std::string_view detail = {}) {
+        throw CompileError{error_code, 0, 0,
+                           construct_error_message(error_code, 0, 0, detail)};
     }
 
-    static std::string construct_error_message(ErrorCode code,
-                                               const size_t line = 0,
-                                               const size_t column = 0) {
+    static std::string construct_error_message(
+        ErrorCode code, const size_t line = 0, const size_t column = 0,
+        const std::string_view detail = {}) {
         std::ostringstream oss;
         oss << get_error_message(code);
 
+        if (!detail.empty()) oss << ": " << detail;
+
         if (line != 0) oss << ", at line: " << line;
 
         if (column != 0) oss << ", column: " << column;
-        oss << ".\n";
+        if (line != 0) oss << ".";
 
         return oss.str();
     }
@@ -56,14 +105,17 @@ class ErrorManager {
     static std::string get_error_message(ErrorCode code) {
         static const std::unordered_map<ErrorCode, std::string> error_messages =
             {
-                {ErrorCode::VariableNotDeclared, "Variable is not declared: "},
+                {ErrorCode::VariableNotDeclared, "Variable is not declared"},
                 {ErrorCode::VariableAlreadyDeclared,
                  "Variable already declared"},
                 {ErrorCode::VariableNotMutable, "Variable is not mutable"},
+                {ErrorCode::DivisionByZero, "Division by zero"},
 
                 {ErrorCode::StringTooLong, "Syntax error: string too long"},
                 {ErrorCode::UnidentifiedToken,
                  "Syntax error: unidentified token"},
+                {ErrorCode::UnterminatedString,
+                 "Syntax error: unterminated string"},
 
                 {ErrorCode::ExpectedExpression,
                  "Syntax error: expected expression"},
@@ -76,12 +128,18 @@ class ErrorManager {
                 {ErrorCode::ExpectedScope, "Syntax error: expected scope"},
                 {ErrorCode::ExpectedIntegerLiteral,
                  "Syntax error: expected integer literal"},
+                {ErrorCode::ExpectedIdentifier,
+                 "Syntax error: expected identifier"},
+                {ErrorCode::IntegerLiteralOverflow,
+                 "Syntax error: integer literal out of range"},
                 {ErrorCode::ExpectedEndOfLine, "Syntax error: expected ;"},
                 {ErrorCode::UnknownOperator, "Syntax error: unknown operator"},
 
                 {ErrorCode::InvalidProgram, "Invalid program"},
                 {ErrorCode::InvalidUsage, "Invalid usage"},
+                {ErrorCode::UnknownPass, "Unknown pass"},
                 {ErrorCode::OpenFileError, "Error opening file"},
+                {ErrorCode::SourceTooLarge, "Source file exceeds 4 GiB"},
             };
 
         auto it = error_messages.find(code);
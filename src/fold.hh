@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string_view>
+
+#include "error.hh"
+#include "parser.hh"
+
+/**
+ * @brief Value of `left <kind> right` as the generated code computes it: add,
+ * sub and mul wrap around in 64 bits, idiv truncates toward zero. Returns
+ * std::nullopt for a division that traps at runtime, the caller decides how
+ * to report a division by zero.
+ */
+inline std::optional<int64_t> evaluate_binary(const node::ExprKind kind,
+                                              const int64_t left,
+                                              const int64_t right) {
+    int64_t result = 0;
+    switch (kind) {
+        case node::ExprKind::Add:
+            __builtin_add_overflow(left, right, &result);
+            return result;
+        case node::ExprKind::Sub:
+            __builtin_sub_overflow(left, right, &result);
+            return result;
+        case node::ExprKind::Mul:
+            // The low half of the unsigned `mul` is the wrapped product
+            __builtin_mul_overflow(left, right, &result);
+            return result;
+        case node::ExprKind::Div:
+            if (right == 0 ||
+                (left == std::numeric_limits<int64_t>::min() && right == -1)) {
+                return std::nullopt;
+            }
+            return left / right;
+        default:
+            return std::nullopt;
+    }
+}
+
+/**
+ * @brief Replaces every operation on integer literals with its value, so
+ * that it is emitted as a single `mov rax, imm`
+ *
+ * A division by a constant zero is reported as an error. INT64_MIN / -1 is
+ * kept, since it traps at runtime like it does without folding.
+ */
+class ConstantFolder {
+   public:
+    ConstantFolder(node::Prog& prog, const std::string_view src)
+        : m_prog(prog), m_src(src) {}
+
+    void fold() {
+        // Operands are created before the expressions using them, so a single
+        // sweep in index order folds the trees bottom-up
+        for (node::ExprId id = 0; id < m_prog.expressions.size(); id++) {
+            node::Expr& expression = m_prog.expressions[id];
+            if (expression.kind == node::ExprKind::Div) {
+                const node::Expr& right =
+                    m_prog.expressions[expression.operands.right];
+                if (right.kind == node::ExprKind::IntLit && right.value == 0) {
+                    ErrorManager::error_expected(ErrorCode::DivisionByZero,
+                                                 m_src, expression.offset);
+                }
+            }
+
+            fold(expression);
+        }
+    }
+
+    /**
+     * @brief Fold `expression` if its operands are literals, the operands are
+     * expected to be folded already. A division by zero is left as is.
+     */
+    void fold(node::Expr& expression) const {
+        if (expression.kind == node::ExprKind::IntLit ||
+            expression.kind == node::ExprKind::Ident) {
+            return;
+        }
+
+        const node::Expr& left = m_prog.expressions[expression.operands.left];
+        const node::Expr& right = m_prog.expressions[expression.operands.right];
+        if (left.kind != node::ExprKind::IntLit ||
+            right.kind != node::ExprKind::IntLit) {
+            return;
+        }
+
+        if (const auto value =
+                evaluate_binary(expression.kind, left.value, right.value)) {
+            expression = node::Expr::int_lit(value.value(), expression.offset);
+        }
+    }
+
+   private:
+    node::Prog& m_prog;
+    // Source m_prog refers to, for diagnostics
+    const std::string_view m_src;
+};
\ No newline at end of file
@@ -1,311 +1,52 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <queue>
+#include <set>
 #include <sstream>
+#include <string>
+#include <string_view>
 #include <utility>
+#include <vector>
 
 #include "config.hh"
-#include "error.hh"
-#include "parser.hh"
-
+#include "ir.hh"
+#include "strength.hh"
+
+/**
+ * @brief x86-64 backend, lowers the IR to nasm assembly
+ *
+ * Every virtual register and every variable slot gets a home, either one of
+ * the registers the runtime leaves alone or a place in the stack frame, which
+ * is reserved once at the start. Homes are assigned by a linear scan over the
+ * live intervals in layout order, and a home is reused once its interval has
+ * ended. As all jumps go forward, an interval from the first to the last
+ * reference in layout order covers every path between them.
+ *
+ * An arithmetic result is computed in its home when that is a register, and
+ * otherwise in rax, which is also used for division. rbx and rdx are scratch
+ * for a single instruction, and a value is not reloaded into rax while rax
+ * still holds it.
+ */
 class Generator {
    public:
-    explicit Generator(node::Prog prog) : m_prog(std::move(prog)) {}
-
-    void gen_term(const node::Term* term) {
-        struct TermVisitor {
-            Generator& gen;
-            void operator()(
-                const node::TermIntLit* term_integer_literal) const {
-                gen.m_start << "    mov rax, "
-                            << term_integer_literal->integer_literal.value
-                            << "\n";
-                gen.push("rax");
-            }
-
-            void operator()(const node::TermIdent* term_identifier) const {
-                // Check if the variable is declared by looking it up in the
-                // variable vector using find_if
-                const auto iterator = std::find_if(
-                    gen.m_vars.cbegin(), gen.m_vars.cend(),
-                    [&](const Var& var) {
-                        return var.name == term_identifier->identifier.value;
-                    });
-                if (iterator == gen.m_vars.cend()) {
-                    std::cerr << ErrorManager::get_error_message(
-                                     ErrorCode::VariableNotDeclared)
-                              << ": " << term_identifier->identifier.value
-                              << "\n";
-                    exit(EXIT_FAILURE);
-                }
-
-                std::ostringstream oss;
-                oss << "QWORD [rsp + "
-                    << (gen.m_stack_pointer - iterator->stack_loc - 1) * 8
-                    << "]";
-                gen.push(oss.str());
-            }
-
-            void operator()(const node::TermParen* term_parenthesis) const {
-                gen.gen_expr(term_parenthesis->expression);
-            }
-        };
-
-        std::visit(TermVisitor{*this}, term->var);
-    }
-
-    void gen_bin_expr(const node::BinExpr* bin_expr) {
-        struct BinExprVisitor {
-            Generator& gen;
-
-            void operator()(
-                const node::BinExprAddition* expr_binary_addition) const {
-                gen.gen_expr(expr_binary_addition->right);
-                gen.gen_expr(expr_binary_addition->left);
-
-                gen.pop("rax");
-                gen.pop("rbx");
-                gen.m_start << "    add rax, rbx\n";
-                gen.push("rax");
-            }
-
-            void operator()(
-                const node::BinExprSubtraction* expr_binary_sub) const {
-                gen.gen_expr(expr_binary_sub->right);
-                gen.gen_expr(expr_binary_sub->left);
-
-                gen.pop("rax");
-                gen.pop("rbx");
-                gen.m_start << "    sub rax, rbx\n";
-                gen.push("rax");
-            }
-
-            void operator()(
-                const node::BinExprMultiplication* expr_binary_multiply) const {
-                gen.gen_expr(expr_binary_multiply->left);
-                gen.gen_expr(expr_binary_multiply->right);
-
-                gen.pop("rax");
-                gen.pop("rbx");
-                gen.m_start << "    xor rdx, rdx\n";  // Clear the high bits
-                gen.m_start << "    mul rbx\n";
-                gen.push("rax");
-            }
-
-            void operator()(
-                const node::BinExprDivision* expr_binary_div) const {
-                gen.gen_expr(expr_binary_div->left);
-                gen.gen_expr(expr_binary_div->right);
-
-                gen.pop("rbx");
-                gen.pop("rax");
-                gen.m_start << "    cqo\n";
-                gen.m_start << "    idiv rbx\n";
-                gen.push("rax");
-            }
-        };
-
-        std::visit(BinExprVisitor{*this}, bin_expr->var);
-    }
-
-    void gen_scope(const node::Scope* scope) {
-        begin_scope();
-
-        for (const auto& statement : scope->statements) {
-            gen_stmt(statement);
-        }
-
-        end_scope();
-    }
-
-    void gen_elif_predicate(const node::ElifBranch* pred_elif,
-                            const std::string& end_jump_label) {
-        gen_expr(pred_elif->condition);
-        pop("rax");
-        const std::string label = create_label();
-
-        m_start << "    test rax, rax\n";
-        m_start << "    jz " << label << "\n";
-
-        gen_scope(pred_elif->scope);
-        m_start << "    jmp " << end_jump_label << "\n";
-
-        m_start << label << ":\n";
-    }
-    void gen_else_predicate(const node::ElseBranch* pred_else) {
-        gen_scope(pred_else->scope);
-    }
-
-    void gen_string_literal(const std::string string_literal) {
-        size_t current_string_counter = m_string_counter++;
-
-        // Add string to the data section
-        m_data << "    string" << current_string_counter << " db '";
-
-        for (const char c : string_literal) {
-            if (c == '\n') {
-                m_data << "', 10, '";
-                continue;
-            }
-
-            m_data << c;
-        }
-        m_data << "', 0\n";
-
-        // Add string length + 1 (for the null terminator) to the data section
-        m_data << "    string" << current_string_counter << "_len"
-               << " equ " << string_literal.size() + 1 << "\n";
-
-        // Load the address of the string into rsi
-        m_start << "    lea rsi, [string" << current_string_counter << "]\n";
-        // Load the length of the string into rcx
-        m_start << "    mov rcx, string" << current_string_counter << "_len"
-                << "\n";
-        m_start << "    call check_and_add_to_buffer\n";
-    }
-
-    void gen_expr(const node::Expr* expression) {
-        struct ExprVisitor {
-            Generator& gen;
-
-            void operator()(const node::Term* term) const {
-                gen.gen_term(term);
-            }
-
-            void operator()(const node::BinExpr* bin_expr) const {
-                gen.gen_bin_expr(bin_expr);
-            }
-        };
-
-        std::visit(ExprVisitor{*this}, expression->var);
-    }
-
-    void gen_arg(const node::StmtArg* statement_print) {
-        struct ArgVisitor {
-            Generator& gen;
-
-            void operator()(const node::Expr* expression) const {
-                gen.gen_expr(expression);
-                gen.m_start << "    mov rsi, QWORD [rsp]\n";
-                gen.m_start << "    call print_int\n";
-                gen.m_start << "    call print_newline\n";
-            }
-
-            void operator()(const node::StringLit* string_literal) const {
-                gen.gen_string_literal(string_literal->string_literal.value);
-            }
-        };
-
-        std::visit(ArgVisitor{*this}, statement_print->var);
-    }
-
-    void gen_stmt(const node::Stmt* statement) {
-        struct StmtVisitor {
-            Generator& gen;
-
-            void operator()(const node::StmtExit* statement_exit) const {
-                gen.gen_expr(statement_exit->expression);
-
-                gen.m_start << "    call flush_buffer\n";
-                gen.m_start << "    mov rax, 60\n";
-                gen.pop("rdi");
-                gen.m_start << "    syscall\n\n";
-            }
-
-            void operator()(const node::StmtArg* statement_print) const {
-                gen.gen_arg(statement_print);
-            }
-
-            void operator()(const node::StmtLet* statement_let) const {
-                // Check if the variable is already declared in the current
-                // scope
-                const auto iterator = std::find_if(
-                    gen.m_vars.cbegin(), gen.m_vars.cend(),
-                    [&](const Var& var) {
-                        return var.name == statement_let->identifier.value &&
-                               var.scope == gen.m_stack_scopes.size() - 1;
-                    });
-                if (iterator != gen.m_vars.cend()) {
-                    ErrorManager::error_expected(
-                        ErrorCode::VariableAlreadyDeclared,
-                        statement_let->identifier.line_number,
-                        statement_let->identifier.col_number);
-                }
-
-                gen.m_vars.push_back(Var{
-                    statement_let->identifier.value, statement_let->is_mutable,
-                    gen.m_stack_pointer, gen.m_stack_scopes.size() - 1});
-                gen.gen_expr(statement_let->expression);
-            }
-
-            void operator()(const node::StmtAssign* statement_assign) const {
-                // Check if the variable is declared by looking it up in the
-                // variable vector using find_if
-                const auto iterator = std::find_if(
-                    gen.m_vars.cbegin(), gen.m_vars.cend(),
-                    [&](const Var& var) {
-                        return var.name == statement_assign->identifier.value;
-                    });
-                if (iterator == gen.m_vars.cend()) {
-                    ErrorManager::error_expected(
-                        ErrorCode::VariableNotDeclared,
-                        statement_assign->identifier.line_number,
-                        statement_assign->identifier.col_number);
-                }
-
-                // Check if the variable is mutable
-                if (!iterator->is_mutable) {
-                    ErrorManager::error_expected(
-                        ErrorCode::VariableNotMutable,
-                        statement_assign->identifier.line_number,
-                        statement_assign->identifier.col_number);
-                }
-
-                gen.gen_expr(statement_assign->expression);
-                gen.pop("rax");
-                gen.m_start
-                    << "    mov QWORD [rsp + "
-                    << (gen.m_stack_pointer - iterator->stack_loc - 1) * 8
-                    << "], rax\n";
-            }
-
-            void operator()(const node::Scope* scope) const {
-                gen.gen_scope(scope);
-            }
-
-            void operator()(const node::StmtIf* statement_if) const {
-                gen.gen_expr(statement_if->if_branch->condition);
-                gen.pop("rax");
-                const std::string label = gen.create_label();
-
-                gen.m_start << "    test rax, rax\n";
-                gen.m_start << "    jz " << label << "\n";
-
-                gen.gen_scope(statement_if->if_branch->scope);
-                const std::string end_label = gen.create_label();
-                gen.m_start << "    jmp " << end_label << "\n";
-
-                gen.m_start << label << ":\n";
-                for (const auto& elif_branch : statement_if->elif_branches) {
-                    gen.gen_elif_predicate(elif_branch, end_label);
-                }
-
-                if (statement_if->else_branch.has_value()) {
-                    gen.gen_else_predicate(statement_if->else_branch.value());
-                }
-
-                gen.m_start << end_label << ":\n";
-            }
-        };
-
-        std::visit(StmtVisitor{*this}, statement->var);
-    }
+    explicit Generator(ir::Program program) : m_program(std::move(program)) {}
 
     [[nodiscard]] std::string gen_prog() {
+        assign_homes();
+
         m_start << "section .text\n"
                 << "    global _start\n\n_start:\n"
                 << "    call initialize_buffer\n";
+        if (m_frame_size > 0) {
+            m_start << "    sub rsp, " << m_frame_size * 8 << "\n";
+        }
 
         m_data << "section .data\n"
                << "    newline db 10\n";
@@ -343,6 +84,15 @@ class Generator {
             "    call print_chars\n"
             "    call print_newline\n"
             "    ret\n"
+            "write_buffer:\n"
+            "    mov rdx, [buffer_used]\n"  // rdx = buffer_used
+            "    test rdx, rdx\n"
+            "    jz .empty\n"             // Nothing to write
+            "    lea rsi, [buffer]\n"     // rsi = buffer
+            "    call print_chars\n"
+            "    mov qword [buffer_used], 0\n"  // Reset buffer_used
+            ".empty:\n"
+            "    ret\n"
             "print_newline:\n"
             "    mov rsi, newline\n"  // rsi = newline
             "    mov rdx, 1\n"        // rdx = 1
@@ -431,71 +181,492 @@ class Generator {
 
         "\n";
 
-        // Parse: start
-        for (const auto& statement : m_prog.statements) {
-            gen_stmt(statement);
-        }
-        // Parse: end
-
-        //  Default exit
-        if (m_prog.statements.empty() ||
-            !std::holds_alternative<node::StmtExit*>(
-                m_prog.statements.back()->var)) {
-            m_start << "    call print_chars\n";
-            m_start << "    mov rdi, 0\n";
-            m_start << "    mov rax, 60\n";
-            m_start << "    syscall\n\n";
+        m_targeted.assign(m_program.blocks.size(), false);
+        for (ir::BlockId id = 0; id < m_program.blocks.size(); id++) {
+            gen_block(id);
         }
 
         return m_data.str() + buffer.str() + m_start.str() + functions;
     }
 
    private:
-    void begin_scope() { m_stack_scopes.push_back(m_vars.size()); }
-    void end_scope() {
-        const size_t variables_to_pop = m_vars.size() - m_stack_scopes.back();
-        if (variables_to_pop == 0) {
-            return;
+    // Registers that can be homes, callee-saved first. The runtime routines
+    // never write them, or save and restore them like print_int does with
+    // rbp and r8, so values stay in them across calls. rax, rbx and rdx are
+    // scratch, rsi, rcx and rdi carry the arguments of the routines, and the
+    // syscall in print_chars clobbers rcx and r11.
+    static constexpr std::array<std::string_view, 8> registers = {
+        "r12", "r13", "r14", "r15", "rbp", "r8", "r9", "r10"};
+
+    // Interval of instruction positions from the definition or first
+    // reference of a value to its last use
+    struct Interval {
+        uint32_t start;
+        uint32_t end;
+        uint32_t* home;
+    };
+
+    void assign_homes() {
+        m_reg_homes.assign(m_program.reg_count, 0);
+        m_slot_homes.assign(m_program.slot_count, 0);
+
+        constexpr uint32_t unused = std::numeric_limits<uint32_t>::max();
+        std::vector<uint32_t> reg_start(m_program.reg_count, unused);
+        std::vector<uint32_t> reg_end(m_program.reg_count, 0);
+        std::vector<uint32_t> slot_start(m_program.slot_count, unused);
+        std::vector<uint32_t> slot_end(m_program.slot_count, 0);
+        const auto reference = [](std::vector<uint32_t>& starts,
+                                  std::vector<uint32_t>& ends,
+                                  const uint32_t index,
+                                  const uint32_t position) {
+            starts[index] = std::min(starts[index], position);
+            ends[index] = position;
+        };
+        const auto use = [&](const ir::Operand& operand,
+                             const uint32_t position) {
+            if (operand.is_reg()) {
+                reference(reg_start, reg_end, operand.reg, position);
+            }
+        };
+
+        uint32_t position = 0;
+        for (const ir::Block& block : m_program.blocks) {
+            for (const ir::Inst& inst : block.insts) {
+                use(inst.a, position);
+                use(inst.b, position);
+                if (inst.dst != ir::none) {
+                    reference(reg_start, reg_end, inst.dst, position);
+                }
+                if (inst.op == ir::Op::Load || inst.op == ir::Op::Store) {
+                    reference(slot_start, slot_end, inst.index, position);
+                }
+                position++;
+            }
+            use(block.terminator.value, position);
+            position++;
         }
-        m_start << "    add rsp, " << variables_to_pop * 8 << "\n";
-        m_stack_pointer -= variables_to_pop;
-        m_vars.resize(m_stack_scopes.back());
-        m_stack_scopes.pop_back();
+
+        std::vector<Interval> intervals;
+        for (ir::Reg reg = 0; reg < m_program.reg_count; reg++) {
+            if (reg_start[reg] != unused) {
+                intervals.push_back(
+                    {reg_start[reg], reg_end[reg], &m_reg_homes[reg]});
+            }
+        }
+        for (ir::Slot slot = 0; slot < m_program.slot_count; slot++) {
+            if (slot_start[slot] != unused) {
+                intervals.push_back(
+                    {slot_start[slot], slot_end[slot], &m_slot_homes[slot]});
+            }
+        }
+        std::sort(intervals.begin(), intervals.end(),
+                  [](const Interval& left, const Interval& right) {
+                      return left.start < right.start;
+                  });
+
+        // A home is free again after the last use of its value, the result
+        // of an instruction may take the home of one of its operands. When
+        // every register is taken, the value that lives the longest goes to
+        // the stack for its whole interval.
+        std::vector<uint32_t> free_registers;
+        for (uint32_t index = registers.size(); index-- > 0;) {
+            free_registers.push_back(index);
+        }
+        std::set<std::pair<uint32_t, size_t>> active;  // End and interval
+        std::vector<size_t> spilled;
+        for (size_t i = 0; i < intervals.size(); i++) {
+            const Interval& interval = intervals[i];
+            while (!active.empty() && active.begin()->first <= interval.start) {
+                free_registers.push_back(
+                    *intervals[active.begin()->second].home);
+                active.erase(active.begin());
+            }
+
+            if (!free_registers.empty()) {
+                *interval.home = free_registers.back();
+                free_registers.pop_back();
+                active.emplace(interval.end, i);
+                continue;
+            }
+
+            const auto longest = std::prev(active.end());
+            if (longest->first > interval.end) {
+                *interval.home = *intervals[longest->second].home;
+                spilled.push_back(longest->second);
+                active.erase(longest);
+                active.emplace(interval.end, i);
+            } else {
+                spilled.push_back(i);
+            }
+        }
+        std::sort(spilled.begin(), spilled.end());
+
+        using Spill = std::pair<uint32_t, uint32_t>;  // End and home
+        std::priority_queue<Spill, std::vector<Spill>, std::greater<>>
+            spills;
+        std::vector<uint32_t> free_homes;
+        for (const size_t i : spilled) {
+            const Interval& interval = intervals[i];
+            while (!spills.empty() && spills.top().first <= interval.start) {
+                free_homes.push_back(spills.top().second);
+                spills.pop();
+            }
+
+            if (free_homes.empty()) {
+                free_homes.push_back(registers.size() + m_frame_size++);
+            }
+            *interval.home = free_homes.back();
+            free_homes.pop_back();
+            spills.emplace(interval.end, *interval.home);
+        }
+    }
+
+    static bool in_register(const uint32_t index) {
+        return index < registers.size();
     }
 
-    std::string create_label() {
+    [[nodiscard]] static std::string home(const uint32_t index) {
+        if (in_register(index)) {
+            return std::string(registers[index]);
+        }
+
         std::ostringstream oss;
-        oss << ".L" << m_label_counter++;
+        oss << "QWORD [rsp + " << (index - registers.size()) * 8 << "]";
         return oss.str();
     }
 
-    void push(const std::string& reg) {
-        m_start << "    push " << reg << "\n";
-        m_stack_pointer++;
+    static bool fits_imm32(const int64_t value) {
+        return value >= std::numeric_limits<int32_t>::min() &&
+               value <= std::numeric_limits<int32_t>::max();
+    }
+
+    // Load `operand` into the register `reg`
+    void load(const std::string_view reg, const ir::Operand& operand) {
+        if (operand.is_reg()) {
+            load_home(reg, m_reg_homes[operand.reg]);
+            return;
+        }
+
+        m_start << "    mov " << reg << ", " << operand.imm << "\n";
+        if (reg == "rax") {
+            m_rax_home = ir::none;
+        }
+    }
+
+    // Load the home `index` into the register `reg`, unless it is that home
+    // or rax already holding it
+    void load_home(const std::string_view reg, const uint32_t index) {
+        if (in_register(index) && registers[index] == reg) {
+            return;
+        }
+        if (reg == "rax") {
+            if (m_rax_home == index) {
+                return;
+            }
+            m_rax_home = index;
+        }
+
+        m_start << "    mov " << reg << ", " << home(index) << "\n";
     }
 
-    void pop(const std::string& reg) {
-        m_start << "    pop " << reg << "\n";
-        m_stack_pointer--;
+    // Store rax to the home `index`, unless rax was loaded from there
+    void store_rax(const uint32_t index) {
+        if (m_rax_home == index) {
+            return;
+        }
+
+        m_start << "    mov " << home(index) << ", rax\n";
+        m_rax_home = index;
     }
 
-    const node::Prog m_prog;
+    // `mnemonic reg, operand`, going through rbx for an immediate beyond 32
+    // bits
+    void gen_with(const std::string_view reg, const std::string_view mnemonic,
+                  const ir::Operand& operand) {
+        if (operand.is_imm() && !fits_imm32(operand.imm)) {
+            load("rbx", operand);
+            m_start << "    " << mnemonic << " " << reg << ", rbx\n";
+            return;
+        }
+
+        m_start << "    " << mnemonic << " " << reg << ", ";
+        if (operand.is_reg()) {
+            m_start << home(m_reg_homes[operand.reg]) << "\n";
+        } else {
+            m_start << operand.imm << "\n";
+        }
+    }
+
+    // Write `value` to the home `index`, through rax only from memory to
+    // memory and for a wide immediate to memory
+    void gen_move(const uint32_t index, const ir::Operand& value) {
+        if (value.is_reg() && m_reg_homes[value.reg] == index) {
+            return;
+        }
+
+        const bool direct =
+            in_register(index) ||
+            (value.is_imm() ? fits_imm32(value.imm)
+                            : in_register(m_reg_homes[value.reg]));
+        if (!direct) {
+            load("rax", value);
+            store_rax(index);
+            return;
+        }
+
+        m_start << "    mov " << home(index) << ", ";
+        if (value.is_reg()) {
+            m_start << home(m_reg_homes[value.reg]) << "\n";
+        } else {
+            m_start << value.imm << "\n";
+        }
+        if (m_rax_home == index) {
+            m_rax_home = ir::none;
+        }
+    }
+
+    // Register to compute the result of `inst` in, from the operand that is
+    // loaded first: the home of the result if that is a register the `other`
+    // operand does not live in, else rax
+    [[nodiscard]] std::string_view accumulator(const ir::Inst& inst,
+                                               const ir::Operand& other) const {
+        const uint32_t index = m_reg_homes[inst.dst];
+        if (!in_register(index) ||
+            (other.is_reg() && m_reg_homes[other.reg] == index)) {
+            return "rax";
+        }
+        return registers[index];
+    }
+
+    void gen_inst(const ir::Inst& inst) {
+        std::string_view result = "rax";
+        switch (inst.op) {
+            case ir::Op::Load:
+                load_home("rax", m_slot_homes[inst.index]);
+                break;
+
+            case ir::Op::Store:
+                gen_move(m_slot_homes[inst.index], inst.a);
+                return;
+
+            case ir::Op::Copy:
+                gen_move(m_reg_homes[inst.dst], inst.a);
+                return;
+
+            case ir::Op::Add:
+            case ir::Op::Sub:
+                result = accumulator(inst, inst.b);
+                load(result, inst.a);
+                gen_with(result, inst.op == ir::Op::Add ? "add" : "sub",
+                         inst.b);
+                break;
+
+            case ir::Op::Mul:
+                if (inst.b.is_imm()) {
+                    result = accumulator(inst, inst.b);
+                    load(result, inst.a);
+                    strength::gen_mul_by_constant(m_start, result, inst.b.imm);
+                } else if (inst.a.is_imm()) {
+                    result = accumulator(inst, inst.a);
+                    load(result, inst.b);
+                    strength::gen_mul_by_constant(m_start, result, inst.a.imm);
+                } else {
+                    result = accumulator(inst, inst.b);
+                    load(result, inst.a);
+                    m_start << "    imul " << result << ", "
+                            << home(m_reg_homes[inst.b.reg]) << "\n";
+                }
+                break;
+
+            case ir::Op::Div:
+                if (inst.may_trap()) {
+                    gen_write_buffer();
+                }
+                load("rax", inst.a);
+                if (inst.b.is_imm() &&
+                    strength::reduces_division(inst.b.imm)) {
+                    strength::gen_div_by_constant(m_start, inst.b.imm);
+                } else {
+                    load("rbx", inst.b);
+                    m_start << "    cqo\n";
+                    m_start << "    idiv rbx\n";
+                }
+                break;
+
+            case ir::Op::PrintInt:
+                gen_write_buffer();
+                load("rsi", inst.a);
+                m_start << "    call print_int\n";
+                m_start << "    call print_newline\n";
+                m_rax_home = ir::none;
+                return;
+
+            case ir::Op::PrintText: {
+                // Chunks of at most MAX_STRING_SIZE bytes always fit the
+                // buffer
+                const std::string_view text = m_program.texts[inst.index];
+                for (size_t offset = 0; offset < text.size();
+                     offset += MAX_STRING_SIZE) {
+                    gen_buffered_text(text.substr(offset, MAX_STRING_SIZE));
+                }
+                m_rax_home = ir::none;
+                m_buffer_empty = false;
+                return;
+            }
+        }
+
+        if (result != "rax") {
+            if (m_rax_home == m_reg_homes[inst.dst]) {
+                m_rax_home = ir::none;
+            }
+            return;
+        }
+
+        // Only a load leaves the value of its home in rax
+        if (inst.op != ir::Op::Load) {
+            m_rax_home = ir::none;
+        }
+        store_rax(m_reg_homes[inst.dst]);
+    }
+
+    /**
+     * @brief Write out the print buffer, so that the text printed so far
+     * comes before what print_int prints, and is not lost when a division
+     * traps
+     */
+    void gen_write_buffer() {
+        if (m_buffer_empty) {
+            return;
+        }
+
+        m_start << "    call write_buffer\n";
+        m_rax_home = ir::none;
+        m_buffer_empty = true;
+    }
+
+    /**
+     * @brief Append `text` to the print buffer, as a string in the data
+     * section
+     */
+    void gen_buffered_text(const std::string_view text) {
+        size_t current_string_counter = m_string_counter++;
+
+        // Add string to the data section, quoting the printable runs
+        m_data << "    string" << current_string_counter << " db ";
+        bool quoted = false;
+        for (size_t i = 0; i < text.size(); i++) {
+            const char c = text[i];
+            const bool printable = c != '\n' && c != '\0' && c != '\'';
+            if (printable != quoted) {
+                m_data << (quoted ? "'" : "") << (i > 0 ? ", " : "")
+                       << (printable ? "'" : "");
+                quoted = printable;
+            } else if (!printable) {
+                m_data << ", ";
+            }
+
+            if (printable) {
+                m_data << c;
+            } else {
+                m_data << static_cast<int>(c);
+            }
+        }
+        m_data << (quoted ? "'" : "") << "\n";
+
+        m_data << "    string" << current_string_counter << "_len"
+               << " equ " << text.size() << "\n";
+
+        // Load the address of the string into rsi
+        m_start << "    lea rsi, [string" << current_string_counter << "]\n";
+        // Load the length of the string into rcx
+        m_start << "    mov rcx, string" << current_string_counter << "_len"
+                << "\n";
+        m_start << "    call check_and_add_to_buffer\n";
+    }
+
+    void gen_block(const ir::BlockId id) {
+        if (m_targeted[id]) {
+            m_start << label(id) << ":\n";
+        }
+        m_rax_home = ir::none;
+        // Only the entry block is known to start with nothing buffered, the
+        // other ones may be reached from blocks that print
+        m_buffer_empty = id == 0;
+
+        const ir::Block& block = m_program.blocks[id];
+        assert(block.phis.empty());
+        for (const ir::Inst& inst : block.insts) {
+            gen_inst(inst);
+        }
+
+        const ir::Terminator& terminator = block.terminator;
+        switch (terminator.kind) {
+            case ir::Terminator::Kind::Jump:
+                gen_jump(id, terminator.target);
+                break;
+
+            case ir::Terminator::Kind::Branch:
+                if (terminator.value.is_imm()) {
+                    gen_jump(id, terminator.value.imm != 0 ? terminator.target
+                                                           : terminator.other);
+                    break;
+                }
+
+                if (terminator.value.is_reg() &&
+                    in_register(m_reg_homes[terminator.value.reg])) {
+                    const std::string reg =
+                        home(m_reg_homes[terminator.value.reg]);
+                    m_start << "    test " << reg << ", " << reg << "\n";
+                } else {
+                    load("rax", terminator.value);
+                    m_start << "    test rax, rax\n";
+                }
+                m_start << "    jz " << label(terminator.other) << "\n";
+                m_targeted[terminator.other] = true;
+                gen_jump(id, terminator.target);
+                break;
+
+            case ir::Terminator::Kind::Exit:
+                m_start << "    call flush_buffer\n";
+                load("rdi", terminator.value);
+                m_start << "    mov rax, 60\n";
+                m_start << "    syscall\n\n";
+                break;
+
+            case ir::Terminator::Kind::Return:
+                m_start << "    call flush_buffer\n";
+                m_start << "    mov rdi, 0\n";
+                m_start << "    mov rax, 60\n";
+                m_start << "    syscall\n\n";
+                break;
+        }
+    }
+
+    // Jump from the end of `from` to `to`, falling through to the next block
+    void gen_jump(const ir::BlockId from, const ir::BlockId to) {
+        if (to == from + 1) {
+            return;
+        }
+
+        m_start << "    jmp " << label(to) << "\n";
+        m_targeted[to] = true;
+    }
+
+    static std::string label(const ir::BlockId id) {
+        return ".L" + std::to_string(id);
+    }
+
+    const ir::Program m_program;
     std::ostringstream m_start;
     std::ostringstream m_data;
 
-    // Keeps track of the stack pointer
-    size_t m_stack_pointer = 0;
-
-    // Keeps track of the variable names
-    struct Var {
-        std::string name;
-        bool is_mutable;
-        size_t stack_loc;
-        size_t scope;
-    };
-    std::vector<Var> m_vars;             // Keeps track of the variables
-    std::vector<size_t> m_stack_scopes;  // Keeps track of the stack scopes
-    size_t m_label_counter = 0;          // Keeps track of the number of labels
-    size_t m_string_counter = 0;         // Keeps track of the number of strings
+    std::vector<uint32_t> m_reg_homes;   // Indexed by Reg
+    std::vector<uint32_t> m_slot_homes;  // Indexed by Slot
+    uint32_t m_frame_size = 0;           // Stack homes, of 8 bytes each
+    uint32_t m_rax_home = ir::none;      // Home whose value rax holds
+    bool m_buffer_empty = true;  // Whether nothing is buffered at this point
+    // Blocks that are jumped to and need a label, all jumps go forward
+    std::vector<bool> m_targeted;
+    size_t m_string_counter = 0;  // Keeps track of the number of strings
     const size_t m_buffer_size = PRINT_BUFFER_SIZE;  // Buffer size
 };
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Dense ID of an interned identifier
+using SymbolId = uint32_t;
+
+/**
+ * @brief Maps identifier spellings to dense 32-bit symbol IDs, so that later
+ * stages compare identifiers as integers. The spellings are views into the
+ * source, thus the Interner must not outlive it.
+ */
+class Interner {
+   public:
+    Interner() {
+        m_ids.reserve(1024);
+        m_names.reserve(1024);
+    }
+
+    Interner(const Interner&) = delete;
+    Interner& operator=(const Interner&) = delete;
+
+    /**
+     * @brief Return the ID of `name`, assigning the next free ID if the name
+     * has not been seen before
+     */
+    SymbolId intern(const std::string_view name) {
+        const auto [iterator, inserted] =
+            m_ids.try_emplace(name, static_cast<SymbolId>(m_names.size()));
+        if (inserted) {
+            m_names.push_back(name);
+        }
+
+        return iterator->second;
+    }
+
+    /**
+     * @brief Spelling of an interned identifier, only needed for diagnostics
+     */
+    [[nodiscard]] std::string_view name(const SymbolId symbol) const {
+        return m_names.at(symbol);
+    }
+
+    [[nodiscard]] size_t size() const { return m_names.size(); }
+
+   private:
+    std::unordered_map<std::string_view, SymbolId> m_ids;
+    std::vector<std::string_view> m_names;  // Indexed by SymbolId
+};
\ No newline at end of file
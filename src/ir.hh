@@ -0,0 +1,283 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Linear three-address IR between the AST passes and the Generator. Every
+// value is a 64-bit integer. A program is a list of basic blocks in layout
+// order, block 0 is the entry, and all jumps go forward, as the language has
+// no loops. Variables live in slots, which are read and written by explicit
+// loads and stores.
+//
+// As lowered, virtual registers are defined once and only used in the block
+// that defines them. The ssa pass replaces the slots by registers that live
+// across blocks, merged by phis where control flow joins, and the out-of-ssa
+// pass replaces the phis by copies at the end of the predecessors, after
+// which a phi's register is defined once per predecessor.
+namespace ir {
+
+// Virtual register
+using Reg = uint32_t;
+// Slot of a variable, numbered like the VarIds it is lowered from
+using Slot = uint32_t;
+// Index of a block in Program::blocks
+using BlockId = uint32_t;
+// Index of a text in Program::texts
+using TextId = uint32_t;
+
+constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+
+// Register or immediate
+struct Operand {
+    enum class Kind : uint8_t {
+        Reg,
+        Imm,
+    };
+
+    Kind kind;
+    union {
+        Reg reg;
+        int64_t imm;
+    };
+
+    static Operand of_reg(const Reg reg) {
+        return Operand{Kind::Reg, {.reg = reg}};
+    }
+
+    static Operand of_imm(const int64_t imm) {
+        return Operand{Kind::Imm, {.imm = imm}};
+    }
+
+    [[nodiscard]] bool is_reg() const { return kind == Kind::Reg; }
+    [[nodiscard]] bool is_imm() const { return kind == Kind::Imm; }
+
+    bool operator==(const Operand& other) const {
+        return kind == other.kind &&
+               (is_reg() ? reg == other.reg : imm == other.imm);
+    }
+};
+
+enum class Op : uint8_t {
+    Load,       // dst = slot
+    Store,      // slot = a
+    Add,        // dst = a + b
+    Sub,        // dst = a - b
+    Mul,        // dst = a * b
+    Div,        // dst = a / b, traps like idiv
+    PrintInt,   // print a and a newline
+    PrintText,  // append text to the print buffer
+    Copy,       // dst = a
+};
+
+struct Inst {
+    Op op;
+    Reg dst{none};
+    uint32_t index{none};  // Slot of Load and Store, TextId of PrintText
+    Operand a{Operand::of_imm(0)};
+    Operand b{Operand::of_imm(0)};
+
+    static Inst load(const Reg dst, const Slot slot) {
+        return Inst{Op::Load, dst, slot};
+    }
+
+    static Inst store(const Slot slot, const Operand value) {
+        return Inst{Op::Store, none, slot, value};
+    }
+
+    static Inst binary(const Op op, const Reg dst, const Operand left,
+                       const Operand right) {
+        return Inst{op, dst, none, left, right};
+    }
+
+    static Inst print_int(const Operand value) {
+        return Inst{Op::PrintInt, none, none, value};
+    }
+
+    static Inst print_text(const TextId text) {
+        return Inst{Op::PrintText, none, text};
+    }
+
+    static Inst copy(const Reg dst, const Operand value) {
+        return Inst{Op::Copy, dst, none, value};
+    }
+
+    [[nodiscard]] bool is_binary() const {
+        return op == Op::Add || op == Op::Sub || op == Op::Mul ||
+               op == Op::Div;
+    }
+
+    // Only a division traps, unless it is by a constant other than 0 and -1
+    [[nodiscard]] bool may_trap() const {
+        return op == Op::Div && !(b.is_imm() && b.imm != 0 && b.imm != -1);
+    }
+};
+
+// How a block ends
+struct Terminator {
+    enum class Kind : uint8_t {
+        Jump,    // to target
+        Branch,  // to target if value is not zero, else to other
+        Exit,    // flush the print buffer and exit with value
+        Return,  // flush the print buffer and exit with 0
+    };
+
+    Kind kind{Kind::Return};
+    Operand value{Operand::of_imm(0)};
+    BlockId target{none};
+    BlockId other{none};
+};
+
+// dst = the value of the incoming operand whose block control came from
+struct Phi {
+    Reg dst;
+    std::vector<std::pair<BlockId, Operand>> incoming;
+};
+
+struct Block {
+    std::vector<Phi> phis;  // Only between the ssa and out-of-ssa passes
+    std::vector<Inst> insts;
+    Terminator terminator;
+};
+
+// Blocks that jump or branch to each block, in layout order
+inline std::vector<std::vector<BlockId>> predecessors(
+    const std::vector<Block>& blocks) {
+    std::vector<std::vector<BlockId>> result(blocks.size());
+    for (BlockId id = 0; id < blocks.size(); id++) {
+        const Terminator& terminator = blocks[id].terminator;
+        if (terminator.kind == Terminator::Kind::Jump) {
+            result[terminator.target].push_back(id);
+        } else if (terminator.kind == Terminator::Kind::Branch) {
+            result[terminator.target].push_back(id);
+            if (terminator.other != terminator.target) {
+                result[terminator.other].push_back(id);
+            }
+        }
+    }
+    return result;
+}
+
+struct Program {
+    std::vector<Block> blocks;
+    // Bytes appended by PrintText, unescaped
+    std::vector<std::string> texts;
+    uint32_t reg_count{0};
+    uint32_t slot_count{0};
+
+    Reg new_reg() { return reg_count++; }
+
+    TextId add_text(std::string text) {
+        texts.push_back(std::move(text));
+        return static_cast<TextId>(texts.size() - 1);
+    }
+};
+
+inline void dump_operand(std::ostream& out, const Operand& operand) {
+    if (operand.is_reg()) {
+        out << "%" << operand.reg;
+    } else {
+        out << operand.imm;
+    }
+}
+
+inline void dump_text(std::ostream& out, const std::string& text) {
+    out << '"';
+    for (const char c : text) {
+        if (c == '\n') {
+            out << "\\n";
+        } else if (c == '\0') {
+            out << "\\0";
+        } else if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+/**
+ * @brief Write `program` in a readable form, one instruction per line
+ */
+inline void dump(std::ostream& out, const Program& program) {
+    static constexpr const char* binary_names[] = {"add", "sub", "mul", "div"};
+
+    for (BlockId id = 0; id < program.blocks.size(); id++) {
+        const Block& block = program.blocks[id];
+        out << "block" << id << ":\n";
+        for (const Phi& phi : block.phis) {
+            out << "    %" << phi.dst << " = phi";
+            for (size_t i = 0; i < phi.incoming.size(); i++) {
+                out << (i > 0 ? ", " : " ") << "[block"
+                    << phi.incoming[i].first << ": ";
+                dump_operand(out, phi.incoming[i].second);
+                out << "]";
+            }
+            out << "\n";
+        }
+        for (const Inst& inst : block.insts) {
+            out << "    ";
+            switch (inst.op) {
+                case Op::Load:
+                    out << "%" << inst.dst << " = load slot" << inst.index;
+                    break;
+                case Op::Store:
+                    out << "store slot" << inst.index << ", ";
+                    dump_operand(out, inst.a);
+                    break;
+                case Op::Add:
+                case Op::Sub:
+                case Op::Mul:
+                case Op::Div:
+                    out << "%" << inst.dst << " = "
+                        << binary_names[static_cast<int>(inst.op) -
+                                        static_cast<int>(Op::Add)]
+                        << " ";
+                    dump_operand(out, inst.a);
+                    out << ", ";
+                    dump_operand(out, inst.b);
+                    break;
+                case Op::PrintInt:
+                    out << "print_int ";
+                    dump_operand(out, inst.a);
+                    break;
+                case Op::PrintText:
+                    out << "print_text ";
+                    dump_text(out, program.texts[inst.index]);
+                    break;
+                case Op::Copy:
+                    out << "%" << inst.dst << " = copy ";
+                    dump_operand(out, inst.a);
+                    break;
+            }
+            out << "\n";
+        }
+
+        const Terminator& terminator = block.terminator;
+        out << "    ";
+        switch (terminator.kind) {
+            case Terminator::Kind::Jump:
+                out << "jump block" << terminator.target;
+                break;
+            case Terminator::Kind::Branch:
+                out << "branch ";
+                dump_operand(out, terminator.value);
+                out << ", block" << terminator.target << ", block"
+                    << terminator.other;
+                break;
+            case Terminator::Kind::Exit:
+                out << "exit ";
+                dump_operand(out, terminator.value);
+                break;
+            case Terminator::Kind::Return:
+                out << "return";
+                break;
+        }
+        out << "\n";
+    }
+}
+}  // namespace ir
\ No newline at end of file
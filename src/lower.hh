@@ -0,0 +1,238 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "ir.hh"
+#include "parser.hh"
+#include "tokenization.hh"
+
+/**
+ * @brief Lowers a program that went through the AST passes to the IR
+ *
+ * Each variable becomes the slot numbered like its VarId, so scopes leave
+ * nothing behind. Blocks are created in source order: an if statement ends
+ * the current block with a branch to its first scope, every condition that
+ * does not hold branches to the test of the next elif, and every scope jumps
+ * to the block after the statement. Statements after an exit go to a block
+ * that nothing jumps to.
+ */
+class Lowering {
+   public:
+    explicit Lowering(const node::Prog& prog) : m_prog(prog) {}
+
+    [[nodiscard]] ir::Program lower() {
+        m_program.slot_count = static_cast<uint32_t>(m_prog.variable_count);
+        start_block();
+        lower_statements(m_prog.statements);
+        terminate(ir::Terminator{ir::Terminator::Kind::Return});
+        return std::move(m_program);
+    }
+
+   private:
+    struct Frame {
+        node::ExprId id;
+        bool operands_done;
+    };
+
+    // Append the instructions computing `root` to the current block,
+    // returns the operand holding its value
+    ir::Operand lower_expr(const node::ExprId root) {
+        m_frames.push_back({root, false});
+        while (!m_frames.empty()) {
+            const Frame frame = m_frames.back();
+            m_frames.pop_back();
+            const node::Expr& expression = m_prog.expressions[frame.id];
+
+            switch (expression.kind) {
+                case node::ExprKind::IntLit:
+                    m_operands.push_back(ir::Operand::of_imm(expression.value));
+                    break;
+                case node::ExprKind::Ident: {
+                    const ir::Reg reg = m_program.new_reg();
+                    emit(ir::Inst::load(reg, expression.variable.var));
+                    m_operands.push_back(ir::Operand::of_reg(reg));
+                    break;
+                }
+                case node::ExprKind::Add:
+                case node::ExprKind::Sub:
+                case node::ExprKind::Mul:
+                case node::ExprKind::Div: {
+                    if (!frame.operands_done) {
+                        // The left operand is lowered first
+                        m_frames.push_back({frame.id, true});
+                        m_frames.push_back({expression.operands.right, false});
+                        m_frames.push_back({expression.operands.left, false});
+                        continue;
+                    }
+
+                    const ir::Operand right = m_operands.back();
+                    m_operands.pop_back();
+                    const ir::Operand left = m_operands.back();
+                    m_operands.pop_back();
+                    const ir::Reg reg = m_program.new_reg();
+                    emit(ir::Inst::binary(binary_op(expression.kind), reg,
+                                          left, right));
+                    m_operands.push_back(ir::Operand::of_reg(reg));
+                    break;
+                }
+            }
+        }
+
+        const ir::Operand value = m_operands.back();
+        m_operands.pop_back();
+        return value;
+    }
+
+    static ir::Op binary_op(const node::ExprKind kind) {
+        switch (kind) {
+            case node::ExprKind::Add:
+                return ir::Op::Add;
+            case node::ExprKind::Sub:
+                return ir::Op::Sub;
+            case node::ExprKind::Mul:
+                return ir::Op::Mul;
+            default:
+                return ir::Op::Div;
+        }
+    }
+
+    void lower_statements(const std::span<node::Stmt* const> statements) {
+        for (const node::Stmt* statement : statements) {
+            lower_stmt(statement);
+        }
+    }
+
+    void lower_stmt(const node::Stmt* statement) {
+        struct StmtVisitor {
+            Lowering& lowering;
+
+            void operator()(const node::StmtExit* statement_exit) const {
+                const ir::Operand value =
+                    lowering.lower_expr(statement_exit->expression);
+                lowering.terminate(ir::Terminator{
+                    ir::Terminator::Kind::Exit, value});
+                lowering.start_block();
+            }
+
+            void operator()(const node::StmtArg* statement_print) const {
+                if (const auto expression =
+                        std::get_if<node::ExprId>(&statement_print->var)) {
+                    lowering.emit(
+                        ir::Inst::print_int(lowering.lower_expr(*expression)));
+                    return;
+                }
+
+                std::string text;
+                unescape(std::get<node::StringLit*>(statement_print->var)
+                             ->literal,
+                         [&](const char c) { text.push_back(c); });
+                // The null terminator is copied to the buffer along with the
+                // string
+                text.push_back('\0');
+                lowering.emit(ir::Inst::print_text(
+                    lowering.m_program.add_text(std::move(text))));
+            }
+
+            void operator()(const node::StmtLet* statement_let) const {
+                lowering.emit(ir::Inst::store(
+                    statement_let->var,
+                    lowering.lower_expr(statement_let->expression)));
+            }
+
+            void operator()(const node::StmtAssign* statement_assign) const {
+                lowering.emit(ir::Inst::store(
+                    statement_assign->var,
+                    lowering.lower_expr(statement_assign->expression)));
+            }
+
+            void operator()(const node::Scope* scope) const {
+                lowering.lower_statements(scope->statements);
+            }
+
+            void operator()(const node::StmtIf* statement_if) const {
+                lowering.lower_if(statement_if);
+            }
+        };
+
+        std::visit(StmtVisitor{*this}, statement->var);
+    }
+
+    void lower_if(const node::StmtIf* statement_if) {
+        const size_t jumps_base = m_jumps.size();
+
+        // Block whose branch goes on to the next test when its condition
+        // does not hold
+        ir::BlockId test = lower_branch(statement_if->if_branch->condition,
+                                        statement_if->if_branch->scope);
+        for (const node::ElifBranch* elif_branch :
+             statement_if->elif_branches) {
+            const ir::BlockId next = start_block();
+            m_program.blocks[test].terminator.other = next;
+            test = lower_branch(elif_branch->condition, elif_branch->scope);
+        }
+
+        if (statement_if->else_branch.has_value()) {
+            const ir::BlockId next = start_block();
+            m_program.blocks[test].terminator.other = next;
+            lower_statements(
+                statement_if->else_branch.value()->scope->statements);
+            m_jumps.push_back(m_current);
+            terminate(ir::Terminator{ir::Terminator::Kind::Jump});
+        }
+
+        const ir::BlockId end = start_block();
+        if (!statement_if->else_branch.has_value()) {
+            m_program.blocks[test].terminator.other = end;
+        }
+        for (size_t i = jumps_base; i < m_jumps.size(); i++) {
+            m_program.blocks[m_jumps[i]].terminator.target = end;
+        }
+        m_jumps.resize(jumps_base);
+    }
+
+    /**
+     * @brief Branch on `condition` to a new block running `scope`, which
+     * jumps to the end of the if statement. Returns the block of the branch.
+     */
+    ir::BlockId lower_branch(const node::ExprId condition,
+                             const node::Scope* scope) {
+        const ir::Operand value = lower_expr(condition);
+        const ir::BlockId test = m_current;
+        terminate(ir::Terminator{ir::Terminator::Kind::Branch, value,
+                                 static_cast<ir::BlockId>(
+                                     m_program.blocks.size())});
+
+        start_block();
+        lower_statements(scope->statements);
+        m_jumps.push_back(m_current);
+        terminate(ir::Terminator{ir::Terminator::Kind::Jump});
+        return test;
+    }
+
+    ir::BlockId start_block() {
+        m_current = static_cast<ir::BlockId>(m_program.blocks.size());
+        m_program.blocks.emplace_back();
+        return m_current;
+    }
+
+    void emit(const ir::Inst& inst) {
+        m_program.blocks[m_current].insts.push_back(inst);
+    }
+
+    void terminate(const ir::Terminator& terminator) {
+        m_program.blocks[m_current].terminator = terminator;
+    }
+
+    const node::Prog& m_prog;
+    ir::Program m_program;
+    ir::BlockId m_current{0};  // Block the instructions are appended to
+    // Blocks ending in a jump to the end of an if statement being lowered
+    std::vector<ir::BlockId> m_jumps;
+    // Explicit stacks for lowering expressions, in place of recursion
+    std::vector<Frame> m_frames;
+    std::vector<ir::Operand> m_operands;
+};
\ No newline at end of file
@@ -1,41 +1,50 @@
 #include "main.hh"
 
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
+    cmm::Options options;
+    const char *filename = nullptr;
+    bool extra_argument = false;
+    for (int i = 1; i < argc; i++) {
+        const std::string_view argument = argv[i];
+        if (argument.starts_with("--dump-ir=")) {
+            options.dump_ir.emplace_back(
+                argument.substr(std::string_view("--dump-ir=").size()));
+        } else if (filename == nullptr) {
+            filename = argv[i];
+        } else {
+            extra_argument = true;
+        }
+    }
+
+    if (filename == nullptr || extra_argument) {
         std::cerr << ErrorManager::get_error_message(ErrorCode::InvalidUsage)
                   << "\n"
-                  << "cmm <filename>\n";
+                  << "cmm [--dump-ir=after:<pass>]... <filename>\n";
         return EXIT_FAILURE;
     }
 
-    std::ifstream input(argv[1]);
-    if (!input) {
+    // The mapping has to stay alive until the code is generated, as all
+    // tokens refer into it
+    const std::optional<SourceFile> source = SourceFile::open(filename);
+    if (!source.has_value()) {
         std::cerr << ErrorManager::get_error_message(ErrorCode::OpenFileError)
-                  << ": " << argv[1] << "\n";
+                  << ": " << filename << "\n";
         return EXIT_FAILURE;
     }
-    std::string contents;
-    {
-        std::stringstream buffer;
-        buffer << input.rdbuf();
-        contents = buffer.str();
-    }
-
-    Tokenizer tokenizer(std::move(contents));
-    std::vector<Token> tokens = tokenizer.tokenize();
 
-    Parser parser(std::move(tokens));
-    std::optional<node::Prog> prog = parser.parse_prog();
-    if (!prog.has_value()) {
-        std::cerr << ErrorManager::get_error_message(ErrorCode::InvalidProgram)
-                  << "\n";
+    const cmm::Result result = cmm::compile(source->contents(), options);
+    if (!result.ok()) {
+        for (const cmm::Diagnostic& diagnostic : result.diagnostics) {
+            std::cerr << diagnostic.message << "\n";
+        }
         return EXIT_FAILURE;
     }
 
-    Generator generator(prog.value());
+    std::cout << result.ir_dump;
+
     {
         std::fstream output("_test/test.asm", std::ios::out);
-        output << generator.gen_prog();
+        output << result.assembly;
     }
 
     return EXIT_SUCCESS;
@@ -1,12 +1,8 @@
 #pragma once
 #include <fstream>
 #include <iostream>
-#include <sstream>
-#include <string>
-#include <vector>
+#include <optional>
 
+#include "cmm.hh"
 #include "error.hh"
-#include "generation.hh"
-#include "parser.hh"
-#include "token_type.hh"
-#include "tokenization.hh"
\ No newline at end of file
+#include "source.hh"
\ No newline at end of file
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <array>
+#include <cassert>
+#include <limits>
+#include <span>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -8,85 +12,97 @@
 #include "tokenization.hh"
 
 namespace node {
-struct TermIntLit {
-    Token integer_literal;
+// The nodes do not keep copies of their tokens, they store the decoded value
+// and the offset of the token in the source for diagnostics. Lists of child
+// nodes are contiguous arrays in the parser's arena.
+
+// Index of an expression in Prog::expressions
+using ExprId = uint32_t;
+
+// Declared variable, numbered in declaration order by the semantic pass
+using VarId = uint32_t;
+constexpr VarId unresolved_var = std::numeric_limits<VarId>::max();
+
+// Expressions are flat: one kind per operator, and the operands refer to
+// other expressions by index. Parentheses only shape the tree and leave no
+// node behind.
+enum class ExprKind : uint8_t {
+    IntLit,
+    Ident,
+    Add,
+    Sub,
+    Mul,
+    Div,
 };
 
-struct TermIdent {
-    Token identifier;
+struct Operands {
+    ExprId left;
+    ExprId right;
 };
 
-struct Expr;
-
-struct TermParen {
-    Expr* expression;
-};
-
-struct StringLit {
-    Token string_literal;
-};
-
-struct BinExprAddition {
-    Expr* left;
-    Expr* right;
-};
-
-struct BinExprMultiplication {
-    Expr* left;
-    Expr* right;
-};
-
-struct BinExprSubtraction {
-    Expr* left;
-    Expr* right;
+struct Variable {
+    SymbolId symbol;
+    VarId var{unresolved_var};
 };
 
-struct BinExprDivision {
-    Expr* left;
-    Expr* right;
-};
+struct Expr {
+    ExprKind kind;
+    uint32_t offset;  // Of the literal, identifier or operator token
+    union {
+        int64_t value;      // IntLit
+        Variable variable;  // Ident
+        Operands operands;  // Add, Sub, Mul, Div
+    };
+
+    static Expr int_lit(const int64_t value, const uint32_t offset) {
+        return Expr{ExprKind::IntLit, offset, {.value = value}};
+    }
 
-struct BinExpr {
-    std::variant<BinExprAddition*, BinExprMultiplication*, BinExprSubtraction*,
-                 BinExprDivision*>
-        var;
-};
+    static Expr ident(const SymbolId symbol, const uint32_t offset) {
+        return Expr{ExprKind::Ident, offset, {.variable = {symbol}}};
+    }
 
-struct Term {
-    std::variant<TermIntLit*, TermIdent*, TermParen*> var;
+    static Expr binary(const ExprKind kind, const ExprId left,
+                       const ExprId right, const uint32_t offset) {
+        return Expr{kind, offset, {.operands = {left, right}}};
+    }
 };
+static_assert(sizeof(Expr) == 16);
 
-struct Expr {
-    std::variant<Term*, BinExpr*> var;
+struct StringLit {
+    // Refers into the source, as spelled without the quotes
+    std::string_view literal;
 };
 
 struct StmtExit {
-    Expr* expression;
+    ExprId expression;
 };
 
 struct StmtArg {
-    std::variant<Expr*, StringLit*> var;
+    std::variant<ExprId, StringLit*> var;
 };
 
 struct StmtLet {
-    Token identifier;
-    Expr* expression;
+    SymbolId symbol;
+    uint32_t offset;
+    ExprId expression;
     bool is_mutable{false};
+    VarId var{unresolved_var};
 };
 
 struct Stmt;
 
 struct Scope {
-    std::vector<Stmt*> statements;
+    std::span<Stmt*> statements;
 };
 
 struct IfBranch {
-    Expr* condition;
+    ExprId condition;
     Scope* scope;
 };
 
 struct ElifBranch {
-    Expr* condition;
+    ExprId condition;
     Scope* scope;
 };
 
@@ -96,13 +112,15 @@ struct ElseBranch {
 
 struct StmtIf {
     IfBranch* if_branch;
-    std::vector<ElifBranch*> elif_branches;
+    std::span<ElifBranch*> elif_branches;
     std::optional<ElseBranch*> else_branch;
 };
 
 struct StmtAssign {
-    Token identifier;
-    Expr* expression;
+    SymbolId symbol;
+    uint32_t offset;
+    ExprId expression;
+    VarId var{unresolved_var};
 };
 
 struct Stmt {
@@ -111,208 +129,132 @@ struct Stmt {
 };
 
 struct Prog {
-    std::vector<Stmt*> statements;
+    std::span<Stmt*> statements;
+    // Operands always precede the expressions using them
+    NodePool<Expr> expressions;
+    size_t variable_count{0};  // Set by the semantic pass
 };
 }  // namespace node
 
 class Parser {
-   public:
-    inline explicit Parser(std::vector<Token> tokens)
-        : m_tokens(std::move(tokens)),
-          m_allocator(1024 * 1024 * 4)  // 4 mb
-    {}
-
-    std::optional<node::Term*> parse_term() {
-        if (auto integer_literal = try_consume(TokenType::INT_LIT)) {
-            auto term_int_lit = m_allocator.emplace<node::TermIntLit>();
-            term_int_lit->integer_literal = integer_literal.value();
-
-            auto term = m_allocator.emplace<node::Term>();
-            term->var = term_int_lit;
-            return term;
-        }
-
-        if (auto identifier = try_consume(TokenType::IDENT)) {
-            auto term_ident = m_allocator.emplace<node::TermIdent>();
-            term_ident->identifier = identifier.value();
-
-            auto term = m_allocator.emplace<node::Term>();
-            term->var = term_ident;
-            return term;
-        }
-
-        if (auto open_paren = try_consume(TokenType::OPEN_PAREN)) {
-            auto term_paren = m_allocator.emplace<node::TermParen>();
-
-            if (const auto expression = parse_expr()) {
-                term_paren->expression = expression.value();
-            } else {
-                error_expected(ErrorCode::ExpectedExpression);
-            }
+    template <typename T>
+    using ArenaVector = std::vector<T, ArenaStlAllocator<T>>;
 
-            try_consume(TokenType::CLOSE_PAREN,
-                        ErrorCode::ExpectedCloseParenthesis);
-
-            auto term = m_allocator.emplace<node::Term>();
-            term->var = term_paren;
-            return term;
-        }
+   public:
+    inline explicit Parser(Tokenizer tokenizer)
+        : m_tokenizer(std::move(tokenizer)),
+          m_allocator(1024 * 64)  // 64 kb, grows with the program
+    {
+        m_statement_stack.reserve(256);
+        m_elif_stack.reserve(16);
+        m_operand_stack.reserve(64);
+        m_operator_stack.reserve(64);
+        m_open_scopes.reserve(16);
+    }
 
-        return std::nullopt;
+    [[nodiscard]] ArenaAllocator::Stats arena_stats() const {
+        return m_allocator.stats();
     }
 
+    // Arena the AST lives in, passes allocate the nodes they add here
+    [[nodiscard]] ArenaAllocator& allocator() { return m_allocator; }
+
     std::optional<node::StringLit*> parse_string_lit() {
-        if (auto string_literal = try_consume(TokenType::STRING_LIT)) {
+        if (const Token* string_literal = try_consume(TokenType::STRING_LIT)) {
             auto string_lit = m_allocator.emplace<node::StringLit>();
-            string_lit->string_literal = string_literal.value();
+            string_lit->literal = string_literal->text(m_tokenizer.source());
             return string_lit;
         }
 
         return std::nullopt;
     }
 
-    // Function takes the minimum precedence level (default 0) and returns the
-    // corresponding expression
-    std::optional<node::Expr*> parse_expr(const size_t minimum_precedence = 0) {
-        std::optional<node::Term*> term_lhs = parse_term();
-        if (!term_lhs.has_value()) {
-            return std::nullopt;
-        }
-
-        auto expression = m_allocator.emplace<node::Expr>();
-        expression->var = term_lhs.value();
+    /**
+     * @brief Parse an expression with the shunting-yard algorithm
+     *
+     * Operands and pending operators are kept on explicit stacks instead of
+     * recursing per precedence level and per parenthesis, so the nesting
+     * depth of the input does not grow the native stack. Operators of equal
+     * precedence associate to the left.
+     */
+    std::optional<node::ExprId> parse_expr() {
+        const size_t operand_base = m_operand_stack.size();
+        const size_t operator_base = m_operator_stack.size();
+        size_t open_parentheses = 0;
 
         while (true) {
-            std::optional<Token> next_token = peek();
-            if (!next_token.has_value()) {
-                break;
-            }
-
-            std::optional<size_t> precedence =
-                binary_precedence(next_token->type);
-            if (!precedence.has_value() ||
-                precedence.value() < minimum_precedence) {
-                break;
-            }
-
-            const Token operator_token = consume();
-            const size_t next_minimum_precedence = precedence.value() + 1;
-            auto expr_rhs = parse_expr(next_minimum_precedence);
-            if (!expr_rhs.has_value()) {
-                error_expected(ErrorCode::ExpectedExpression);
+            // Operand: any number of opening parentheses and a term
+            while (const Token* open_paren =
+                       try_consume(TokenType::OPEN_PAREN)) {
+                m_operator_stack.push_back(
+                    PendingOperator{std::nullopt, 0, open_paren->offset});
+                open_parentheses++;
             }
 
-            auto bin_expr = m_allocator.emplace<node::BinExpr>();
-            auto expr_lhs = m_allocator.emplace<node::Expr>();
-            if (operator_token.type == TokenType::PLUS) {
-                expr_lhs->var = expression->var;
-
-                auto expr_binary_addition =
-                    m_allocator.emplace<node::BinExprAddition>();
-                expr_binary_addition->left = expr_lhs;
-                expr_binary_addition->right = expr_rhs.value();
-
-                bin_expr->var = expr_binary_addition;
-            } else if (operator_token.type == TokenType::MINUS) {
-                expr_lhs->var = expression->var;
-
-                auto expr_binary_subtraction =
-                    m_allocator.emplace<node::BinExprSubtraction>();
-                expr_binary_subtraction->left = expr_lhs;
-                expr_binary_subtraction->right = expr_rhs.value();
-
-                bin_expr->var = expr_binary_subtraction;
-            } else if (operator_token.type == TokenType::FORWARD_SLASH) {
-                expr_lhs->var = expression->var;
-
-                auto expr_binary_division =
-                    m_allocator.emplace<node::BinExprDivision>();
-                expr_binary_division->left = expr_lhs;
-                expr_binary_division->right = expr_rhs.value();
-
-                bin_expr->var = expr_binary_division;
-            } else if (operator_token.type == TokenType::STAR) {
-                expr_lhs->var = expression->var;
-
-                auto expr_binary_multiplication =
-                    m_allocator.emplace<node::BinExprMultiplication>();
-                expr_binary_multiplication->left = expr_lhs;
-                expr_binary_multiplication->right = expr_rhs.value();
-
-                bin_expr->var = expr_binary_multiplication;
+            if (const Token* integer_literal =
+                    try_consume(TokenType::INT_LIT)) {
+                m_operand_stack.push_back(m_expressions.push_back(
+                    node::Expr::int_lit(integer(*integer_literal),
+                                        integer_literal->offset)));
+            } else if (const Token* identifier =
+                           try_consume(TokenType::IDENT)) {
+                m_operand_stack.push_back(m_expressions.push_back(
+                    node::Expr::ident(identifier->symbol, identifier->offset)));
+            } else if (m_operator_stack.size() == operator_base) {
+                // Nothing of an expression has been consumed
+                return std::nullopt;
             } else {
-                error_expected(ErrorCode::UnknownOperator);
+                error_expected(ErrorCode::ExpectedExpression);
             }
 
-            expression->var = bin_expr;
-        }
-
-        return expression;
-    }
-
-    std::optional<node::ElseBranch*> parse_else() {
-        if (try_consume(TokenType::ELSE, true)) {
-            auto scope = parse_scope();
-            if (!scope.has_value()) {
-                error_expected(ErrorCode::ExpectedScope);
+            // Closing parentheses that belong to this expression, the ones
+            // beyond belong to the enclosing statement
+            while (open_parentheses > 0 &&
+                   try_consume(TokenType::CLOSE_PAREN)) {
+                reduce_operators(operator_base, 0);
+                m_operator_stack.pop_back();
+                open_parentheses--;
             }
 
-            node::ElseBranch* else_branch =
-                m_allocator.emplace<node::ElseBranch>();
-            else_branch->scope = scope.value();
-
-            return else_branch;
-        }
-
-        return std::nullopt;
-    }
-
-    std::vector<node::ElifBranch*> parse_elif() {
-        std::vector<node::ElifBranch*> branches;
-        while (try_consume(TokenType::ELIF, true)) {
-            try_consume(TokenType::OPEN_PAREN,
-                        ErrorCode::ExpectedOpenParenthesis);
-
-            node::ElifBranch* elif_branch =
-                m_allocator.emplace<node::ElifBranch>();
-            if (const auto expression = parse_expr()) {
-                elif_branch->condition = expression.value();
-            } else {
-                error_expected(ErrorCode::ExpectedExpression);
+            // Binary operator or the end of the expression
+            const Token* next_token = peek();
+            const std::optional<size_t> precedence =
+                next_token != nullptr ? binary_precedence(next_token->type)
+                                      : std::nullopt;
+            if (!precedence.has_value()) {
+                break;
             }
-            try_consume(TokenType::CLOSE_PAREN,
-                        ErrorCode::ExpectedCloseParenthesis);
 
-            auto scope = parse_scope();
-            if (!scope.has_value()) {
-                error_expected(ErrorCode::ExpectedScope);
+            const Token& operator_token = consume();
+            const std::optional<node::ExprKind> kind =
+                binary_kind(operator_token.type);
+            if (!kind.has_value()) {
+                error_expected(ErrorCode::UnknownOperator);
             }
-            elif_branch->scope = scope.value();
 
-            branches.push_back(elif_branch);
+            reduce_operators(operator_base, precedence.value());
+            m_operator_stack.push_back(PendingOperator{
+                kind, precedence.value(), operator_token.offset});
         }
 
-        return branches;
-    }
-
-    std::optional<node::Scope*> parse_scope() {
-        if (try_consume(TokenType::OPEN_CURLY, false)) {
-            consume();
-            node::Scope* scope = m_allocator.emplace<node::Scope>();
-
-            while (auto stmt = parse_stmt()) {
-                scope->statements.push_back(stmt.value());
-            }
-
-            try_consume(TokenType::CLOSE_CURLY, ErrorCode::ExpectedCloseCurly);
-
-            return scope;
+        if (open_parentheses > 0) {
+            error_expected(ErrorCode::ExpectedCloseParenthesis);
         }
 
-        return std::nullopt;
+        reduce_operators(operator_base, 0);
+        const node::ExprId expression = m_operand_stack.back();
+        m_operand_stack.resize(operand_base);
+        return expression;
     }
 
-    std::optional<node::Stmt*> parse_stmt() {
+    /**
+     * @brief Parse the statement at the current token onto the statement
+     * stack, returns false if no statement starts here
+     *
+     * Statements with a scope only have their head parsed here, they open
+     * the scope and are completed by close_scope() once its `}` is reached.
+     */
+    bool parse_stmt() {
         // Parse exit statement
         if (try_consume(TokenType::EXIT, false) &&
             try_consume(TokenType::OPEN_PAREN, false, 1)) {
@@ -330,9 +272,8 @@ class Parser {
                         ErrorCode::ExpectedCloseParenthesis);
             try_consume(TokenType::END_OF_LINE, ErrorCode::ExpectedEndOfLine);
 
-            node::Stmt* statement = m_allocator.emplace<node::Stmt>();
-            statement->var = stmt_exit;
-            return statement;
+            push_stmt(stmt_exit);
+            return true;
         }
 
         // Parse print statement
@@ -355,9 +296,8 @@ class Parser {
                         ErrorCode::ExpectedCloseParenthesis);
             try_consume(TokenType::END_OF_LINE, ErrorCode::ExpectedEndOfLine);
 
-            node::Stmt* statement = m_allocator.emplace<node::Stmt>();
-            statement->var = statement_argument;
-            return statement;
+            push_stmt(statement_argument);
+            return true;
         }
 
         if (try_consume(TokenType::LET, false)) {
@@ -370,7 +310,10 @@ class Parser {
                 statement_let->is_mutable = true;
             }
             // Parse identifier
-            statement_let->identifier = consume();
+            const Token& identifier =
+                try_consume(TokenType::IDENT, ErrorCode::ExpectedIdentifier);
+            statement_let->symbol = identifier.symbol;
+            statement_let->offset = identifier.offset;
             consume();
 
             // Parse expression
@@ -382,19 +325,19 @@ class Parser {
 
             try_consume(TokenType::END_OF_LINE, ErrorCode::ExpectedEndOfLine);
 
-            node::Stmt* statement = m_allocator.emplace<node::Stmt>();
-            statement->var = statement_let;
-            return statement;
+            push_stmt(statement_let);
+            return true;
         }
 
         // Assign statement
         if (try_consume(TokenType::IDENT, false) &&
             try_consume(TokenType::EQ, false, 1)) {
-            auto identifier = consume();
-            consume();
             node::StmtAssign* statement_assign =
                 m_allocator.emplace<node::StmtAssign>();
-            statement_assign->identifier = identifier;
+            const Token& identifier = consume();
+            statement_assign->symbol = identifier.symbol;
+            statement_assign->offset = identifier.offset;
+            consume();
 
             if (const auto expression = parse_expr()) {
                 statement_assign->expression = expression.value();
@@ -404,21 +347,14 @@ class Parser {
 
             try_consume(TokenType::END_OF_LINE, ErrorCode::ExpectedEndOfLine);
 
-            node::Stmt* statement = m_allocator.emplace<node::Stmt>();
-            statement->var = statement_assign;
-            return statement;
+            push_stmt(statement_assign);
+            return true;
         }
 
         // Parse scope
         if (try_consume(TokenType::OPEN_CURLY, false)) {
-            auto scope = parse_scope();
-            if (!scope.has_value()) {
-                error_expected(ErrorCode::ExpectedScope);
-            }
-
-            node::Stmt* statement = m_allocator.emplace<node::Stmt>();
-            statement->var = scope.value();
-            return statement;
+            open_scope(OpenScope{ScopeRole::Block});
+            return true;
         }
 
         // Parse if statement
@@ -434,85 +370,297 @@ class Parser {
             }
             node::IfBranch* if_branch = m_allocator.emplace<node::IfBranch>();
             if_branch->condition = expression.value();
+            stmt_if->if_branch = if_branch;
 
             try_consume(TokenType::CLOSE_PAREN,
                         ErrorCode::ExpectedCloseParenthesis);
 
-            auto scope = parse_scope();
-            if (!scope.has_value()) {
-                error_expected(ErrorCode::ExpectedScope);
-            }
-            if_branch->scope = scope.value();
-            stmt_if->if_branch = if_branch;
-
-            stmt_if->elif_branches = parse_elif();
-
-            if (auto else_branch = parse_else()) {
-                stmt_if->else_branch = else_branch.value();
-            }
-
-            node::Stmt* statement = m_allocator.emplace<node::Stmt>();
-            statement->var = stmt_if;
-            return statement;
+            open_scope(
+                OpenScope{ScopeRole::If, stmt_if, m_elif_stack.size()});
+            return true;
         }
 
-        return std::nullopt;
+        return false;
     }
 
     std::optional<node::Prog> parse_prog() {
-        node::Prog prog{};
-        while (peek().has_value()) {
-            if (const auto statement = parse_stmt()) {
-                prog.statements.push_back(statement.value());
-            } else {
+        const size_t base = m_statement_stack.size();
+        while (true) {
+            if (!m_open_scopes.empty()) {
+                if (try_consume(TokenType::CLOSE_CURLY)) {
+                    close_scope();
+                } else if (!parse_stmt()) {
+                    error_expected(ErrorCode::ExpectedCloseCurly);
+                }
+                continue;
+            }
+
+            if (peek() == nullptr) {
+                break;
+            }
+
+            if (!parse_stmt()) {
                 error_expected(ErrorCode::InvalidProgram);
             }
         }
 
-        return prog;
+        return node::Prog{freeze(m_statement_stack, base),
+                          std::move(m_expressions)};
     }
 
    private:
-    [[nodiscard]] std::optional<Token> peek(const size_t offset = 0) const {
-        if (m_index + offset >= m_tokens.size()) {
-            return std::nullopt;
+    // Tokens are pulled from the tokenizer on demand and buffered in a
+    // window of `lookahead` tokens, which covers the one token parse_stmt
+    // looks past the current one (`exit(`, `print(`, `if(`, `ident =`).
+    // peek(), consume() and try_consume() hand out tokens by reference into
+    // the window, which stays valid until the next call to any of them.
+    static constexpr size_t lookahead = 2;
+
+    [[nodiscard]] const Token* peek(const size_t offset = 0) {
+        assert(offset < lookahead);
+        while (m_window_size <= offset) {
+            auto token = m_tokenizer.next_token();
+            if (!token.has_value()) {
+                return nullptr;
+            }
+
+            const size_t slot = (m_window_start + m_window_size) % lookahead;
+            m_window[slot] = token.value();
+            if (token->type == TokenType::INT_LIT) {
+                m_window_integers[slot] = m_tokenizer.last_integer();
+            }
+            m_window_size++;
         }
 
-        return m_tokens.at(m_index + offset);
+        return &m_window[(m_window_start + offset) % lookahead];
+    }
+
+    // Value of the INT_LIT `token`, which has to be in the window
+    [[nodiscard]] int64_t integer(const Token& token) const {
+        return m_window_integers[&token - m_window.data()];
     }
 
-    Token consume() { return m_tokens.at(m_index++); }
+    const Token& consume() {
+        const Token* token = peek();
+        if (token == nullptr) {
+            error_expected(ErrorCode::InvalidProgram);
+        }
+
+        m_window_start = (m_window_start + 1) % lookahead;
+        m_window_size--;
+        return *token;
+    }
 
-    void error_expected(const ErrorCode error_code) const {
-        std::cerr << ErrorManager::construct_error_message(
-            error_code, peek()->line_number, peek()->col_number);
-        exit(EXIT_FAILURE);
+    // Reports the error at the current token, or at the end of the source
+    // if all tokens are consumed
+    [[noreturn]] void error_expected(const ErrorCode error_code) {
+        const Token* lexme = peek();
+        ErrorManager::error_expected(
+            error_code, m_tokenizer.source(),
+            lexme != nullptr ? lexme->offset : m_tokenizer.source().size());
     }
 
-    Token try_consume(const TokenType type, const ErrorCode error_code) {
-        auto lexme = peek();
-        if (lexme.has_value() && lexme.value().type == type) {
+    const Token& try_consume(const TokenType type,
+                             const ErrorCode error_code) {
+        const Token* lexme = peek();
+        if (lexme != nullptr && lexme->type == type) {
             return consume();
         }
 
-        std::cerr << ErrorManager::construct_error_message(
-            error_code, lexme->line_number, lexme->col_number);
-        exit(EXIT_FAILURE);
+        error_expected(error_code);
     }
 
-    std::optional<Token> try_consume(const TokenType type,
-                                     const bool consume_token = true,
-                                     const size_t offset = 0) {
-        auto lexme = peek(offset);
-        if (lexme.has_value() && lexme.value().type == type) {
-            if (consume_token) return consume();
+    const Token* try_consume(const TokenType type,
+                             const bool consume_token = true,
+                             const size_t offset = 0) {
+        const Token* lexme = peek(offset);
+        if (lexme != nullptr && lexme->type == type) {
+            if (consume_token) return &consume();
             return lexme;
         }
 
-        return std::nullopt;
+        return nullptr;
+    }
+
+    static std::optional<node::ExprKind> binary_kind(const TokenType type) {
+        switch (type) {
+            case TokenType::PLUS:
+                return node::ExprKind::Add;
+            case TokenType::MINUS:
+                return node::ExprKind::Sub;
+            case TokenType::STAR:
+                return node::ExprKind::Mul;
+            case TokenType::FORWARD_SLASH:
+                return node::ExprKind::Div;
+            default:
+                return std::nullopt;
+        }
+    }
+
+    // Operator waiting on the shunting-yard stack, or an open parenthesis if
+    // `kind` is empty
+    struct PendingOperator {
+        std::optional<node::ExprKind> kind;
+        size_t precedence;
+        uint32_t offset;
+    };
+
+    /**
+     * @brief Apply the pending operators above `base` that bind at least as
+     * tightly as `precedence`, up to the innermost open parenthesis
+     */
+    void reduce_operators(const size_t base, const size_t precedence) {
+        while (m_operator_stack.size() > base) {
+            const PendingOperator& pending = m_operator_stack.back();
+            if (!pending.kind.has_value() || pending.precedence < precedence) {
+                break;
+            }
+
+            const node::ExprId right = m_operand_stack.back();
+            m_operand_stack.pop_back();
+            const node::ExprId left = m_operand_stack.back();
+            m_operand_stack.back() = m_expressions.push_back(node::Expr::binary(
+                pending.kind.value(), left, right, pending.offset));
+            m_operator_stack.pop_back();
+        }
+    }
+
+    // What a scope belongs to, which decides how parsing continues after its
+    // closing `}`
+    enum class ScopeRole {
+        Block,
+        If,
+        Elif,
+        Else,
+    };
+
+    // Scope whose `}` has not been reached yet
+    struct OpenScope {
+        ScopeRole role;
+        node::StmtIf* stmt_if{nullptr};
+        size_t elif_base{0};  // Start of the if statement's elif branches
+        node::ElifBranch* elif_branch{nullptr};
+        node::Scope* scope{nullptr};
+        size_t statement_base{0};  // Start of the scope's statements
+    };
+
+    /**
+     * @brief Consume the `{` of a scope and make it the innermost open scope
+     */
+    void open_scope(OpenScope open_scope) {
+        try_consume(TokenType::OPEN_CURLY, ErrorCode::ExpectedScope);
+        open_scope.scope = m_allocator.emplace<node::Scope>();
+        open_scope.statement_base = m_statement_stack.size();
+        m_open_scopes.push_back(open_scope);
+    }
+
+    /**
+     * @brief Complete the innermost open scope after its `}`, and with it the
+     * statement it belongs to unless an elif or else branch follows
+     */
+    void close_scope() {
+        const OpenScope closed = m_open_scopes.back();
+        m_open_scopes.pop_back();
+        closed.scope->statements =
+            freeze(m_statement_stack, closed.statement_base);
+
+        switch (closed.role) {
+            case ScopeRole::Block:
+                push_stmt(closed.scope);
+                return;
+            case ScopeRole::If:
+                closed.stmt_if->if_branch->scope = closed.scope;
+                break;
+            case ScopeRole::Elif:
+                closed.elif_branch->scope = closed.scope;
+                m_elif_stack.push_back(closed.elif_branch);
+                break;
+            case ScopeRole::Else: {
+                node::ElseBranch* else_branch =
+                    m_allocator.emplace<node::ElseBranch>();
+                else_branch->scope = closed.scope;
+                closed.stmt_if->else_branch = else_branch;
+                push_stmt(closed.stmt_if);
+                return;
+            }
+        }
+
+        continue_if(closed.stmt_if, closed.elif_base);
+    }
+
+    /**
+     * @brief After the scope of an if or elif branch, open the next elif or
+     * else branch or complete the if statement
+     */
+    void continue_if(node::StmtIf* stmt_if, const size_t elif_base) {
+        if (try_consume(TokenType::ELIF)) {
+            try_consume(TokenType::OPEN_PAREN,
+                        ErrorCode::ExpectedOpenParenthesis);
+
+            node::ElifBranch* elif_branch =
+                m_allocator.emplace<node::ElifBranch>();
+            if (const auto expression = parse_expr()) {
+                elif_branch->condition = expression.value();
+            } else {
+                error_expected(ErrorCode::ExpectedExpression);
+            }
+            try_consume(TokenType::CLOSE_PAREN,
+                        ErrorCode::ExpectedCloseParenthesis);
+
+            open_scope(
+                OpenScope{ScopeRole::Elif, stmt_if, elif_base, elif_branch});
+            return;
+        }
+
+        stmt_if->elif_branches = freeze(m_elif_stack, elif_base);
+        if (try_consume(TokenType::ELSE)) {
+            open_scope(OpenScope{ScopeRole::Else, stmt_if, elif_base});
+            return;
+        }
+
+        push_stmt(stmt_if);
+    }
+
+    /**
+     * @brief Append a complete statement to the innermost open list
+     */
+    template <typename T>
+    void push_stmt(T* statement_node) {
+        node::Stmt* statement = m_allocator.emplace<node::Stmt>();
+        statement->var = statement_node;
+        m_statement_stack.push_back(statement);
+    }
+
+    /**
+     * @brief Move the nodes pushed onto `stack` since `base` into one array in
+     * the arena. Nested lists are built on the same stack, so the children
+     * of a list are only contiguous once the list is complete.
+     */
+    template <typename T>
+    std::span<T> freeze(ArenaVector<T>& stack, const size_t base) {
+        const std::span<T> items = m_allocator.copy_array<T>(
+            std::span<const T>{stack}.subspan(base));
+        stack.resize(base);
+        return items;
     }
 
-    const std::vector<Token> m_tokens;
-    size_t m_index{0};
+    Tokenizer m_tokenizer;
+    std::array<Token, lookahead> m_window;
+    // Values of the INT_LIT tokens of the window, slot by slot
+    std::array<int64_t, lookahead> m_window_integers{};
+    size_t m_window_start{0};  // Position of the current token in the window
+    size_t m_window_size{0};   // Number of tokens in the window
     ArenaAllocator m_allocator;
+    NodePool<node::Expr> m_expressions{m_allocator};
+    // Scratch stacks for the lists under construction, reused across lists.
+    // They grow with the length of a list, so they are kept in the arena
+    // instead of making heap allocations as the program grows.
+    ArenaVector<node::Stmt*> m_statement_stack{
+        ArenaStlAllocator<node::Stmt*>{m_allocator}};
+    ArenaVector<node::ElifBranch*> m_elif_stack{
+        ArenaStlAllocator<node::ElifBranch*>{m_allocator}};
+    // Explicit parse stacks, in place of recursion on nested input
+    std::vector<node::ExprId> m_operand_stack;
+    std::vector<PendingOperator> m_operator_stack;
+    std::vector<OpenScope> m_open_scopes;
 };
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "error.hh"
+#include "ir.hh"
+
+struct PassTiming {
+    std::string name;
+    std::chrono::nanoseconds duration;
+};
+
+/**
+ * @brief Runs the registered IR passes in order, times each one and dumps
+ * the IR after the requested passes
+ */
+class PassManager {
+   public:
+    using Pass = std::function<void(ir::Program&)>;
+
+    void add(std::string name, Pass pass) {
+        m_passes.push_back(Registered{std::move(name), std::move(pass)});
+    }
+
+    /**
+     * @brief Dump the IR as requested by `spec`: `after:<pass>` for one of
+     * the registered passes, or `after:all` for every pass
+     */
+    void dump(const std::string_view spec) {
+        constexpr std::string_view prefix = "after:";
+        if (!spec.starts_with(prefix)) {
+            ErrorManager::error(ErrorCode::InvalidUsage,
+                                "--dump-ir=" + std::string(spec));
+        }
+
+        const std::string_view name = spec.substr(prefix.size());
+        if (name == "all") {
+            for (Registered& pass : m_passes) {
+                pass.dump = true;
+            }
+            return;
+        }
+
+        const auto pass = std::find_if(
+            m_passes.begin(), m_passes.end(),
+            [&](const Registered& registered) {
+                return registered.name == name;
+            });
+        if (pass == m_passes.end()) {
+            ErrorManager::error(ErrorCode::UnknownPass, name);
+        }
+        pass->dump = true;
+    }
+
+    void run(ir::Program& program) {
+        for (const Registered& pass : m_passes) {
+            const auto start = std::chrono::steady_clock::now();
+            pass.run(program);
+            const auto duration = std::chrono::steady_clock::now() - start;
+            m_timings.push_back(PassTiming{pass.name, duration});
+
+            if (pass.dump) {
+                m_dumps << "; IR after " << pass.name << "\n";
+                ir::dump(m_dumps, program);
+            }
+        }
+    }
+
+    [[nodiscard]] const std::vector<PassTiming>& timings() const {
+        return m_timings;
+    }
+
+    [[nodiscard]] std::string dumps() const { return m_dumps.str(); }
+
+   private:
+    struct Registered {
+        std::string name;
+        Pass run;
+        bool dump{false};
+    };
+
+    std::vector<Registered> m_passes;
+    std::vector<PassTiming> m_timings;
+    std::ostringstream m_dumps;
+};
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ir.hh"
+
+/**
+ * @brief Turns the prints of constants into text and merges the texts
+ * printed in a row into one, so that each run costs one append to the print
+ * buffer
+ *
+ * A constant is formatted with its newline here instead of by print_int at
+ * runtime. The merged text is appended where the run ends: before a print of
+ * a runtime value, before a division that may trap, and at the end of the
+ * block. The Generator writes the buffer out before both of these, so the
+ * text keeps its place in the output, and is printed before a trap. Loads,
+ * stores and other arithmetic do not end a run.
+ */
+class PrintTextCombiner {
+   public:
+    explicit PrintTextCombiner(ir::Program& program) : m_program(program) {}
+
+    void combine() {
+        for (ir::Block& block : m_program.blocks) {
+            combine(block);
+        }
+    }
+
+   private:
+    void combine(ir::Block& block) {
+        size_t kept = 0;
+        for (const ir::Inst& inst : block.insts) {
+            if (inst.op == ir::Op::PrintText) {
+                m_pending += m_program.texts[inst.index];
+                continue;
+            }
+
+            if (inst.op == ir::Op::PrintInt) {
+                if (inst.a.is_imm()) {
+                    m_pending += std::to_string(inst.a.imm);
+                    m_pending += '\n';
+                    continue;
+                }
+
+                flush(block, kept);
+            } else if (inst.may_trap()) {
+                flush(block, kept);
+            }
+
+            block.insts[kept++] = inst;
+        }
+
+        flush(block, kept);
+        block.insts.resize(kept);
+    }
+
+    // Put the pending text at `kept`. The text comes from at least one
+    // removed print, so `kept` is behind the instruction being visited.
+    void flush(ir::Block& block, size_t& kept) {
+        if (m_pending.empty()) {
+            return;
+        }
+
+        block.insts[kept++] = ir::Inst::print_text(
+            m_program.add_text(std::exchange(m_pending, {})));
+    }
+
+    ir::Program& m_program;
+    std::string m_pending;  // Text of the run of prints being merged
+};
\ No newline at end of file
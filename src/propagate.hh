@@ -0,0 +1,132 @@
+#pragma once
+
+#include <limits>
+#include <span>
+#include <variant>
+#include <vector>
+
+#include "fold.hh"
+#include "parser.hh"
+
+/**
+ * @brief Replaces reads of immutable variables whose initializer folds to a
+ * constant with that constant, folds what becomes constant through that, and
+ * removes the declarations, so the variables get no stack slot
+ *
+ * Runs after the semantic pass and constant folding. Every VarId belongs to a
+ * single declaration, so shadowed variables are told apart without tracking
+ * scopes here. A divisor that only becomes zero through propagation is not
+ * reported, the division traps at runtime if it is ever executed.
+ */
+class ConstantPropagator {
+   public:
+    explicit ConstantPropagator(node::Prog& prog)
+        : m_prog(prog),
+          m_folder(prog, {}),  // Only folds, never reports
+          m_initializers(prog.variable_count, no_initializer) {}
+
+    void propagate() {
+        collect_initializers(m_prog.statements);
+
+        // A declaration precedes the reads of its variable in the source, so
+        // its initializer precedes them in the pool and is folded by the time
+        // the sweep reaches a read
+        for (node::ExprId id = 0; id < m_prog.expressions.size(); id++) {
+            node::Expr& expression = m_prog.expressions[id];
+            if (expression.kind != node::ExprKind::Ident) {
+                m_folder.fold(expression);
+                continue;
+            }
+
+            if (const auto value = constant_value(expression.variable.var)) {
+                expression =
+                    node::Expr::int_lit(value.value(), expression.offset);
+            }
+        }
+
+        m_prog.statements = remove_declarations(m_prog.statements);
+    }
+
+   private:
+    static constexpr node::ExprId no_initializer =
+        std::numeric_limits<node::ExprId>::max();
+
+    // Value of an immutable variable, if its initializer is a constant
+    [[nodiscard]] std::optional<int64_t> constant_value(
+        const node::VarId var) const {
+        const node::ExprId initializer = m_initializers[var];
+        if (initializer == no_initializer) {
+            return std::nullopt;
+        }
+
+        const node::Expr& expression = m_prog.expressions[initializer];
+        if (expression.kind != node::ExprKind::IntLit) {
+            return std::nullopt;
+        }
+
+        return expression.value;
+    }
+
+    void collect_initializers(const std::span<node::Stmt*> statements) {
+        for (const node::Stmt* statement : statements) {
+            if (const auto statement_let =
+                    std::get_if<node::StmtLet*>(&statement->var)) {
+                if (!(*statement_let)->is_mutable) {
+                    m_initializers[(*statement_let)->var] =
+                        (*statement_let)->expression;
+                }
+            } else {
+                for_each_scope(statement, [&](const node::Scope* scope) {
+                    collect_initializers(scope->statements);
+                });
+            }
+        }
+    }
+
+    /**
+     * @brief Remove the declarations of the propagated variables from
+     * `statements` in place, returns the statements that are kept
+     */
+    std::span<node::Stmt*> remove_declarations(
+        const std::span<node::Stmt*> statements) {
+        size_t kept = 0;
+        for (node::Stmt* statement : statements) {
+            if (const auto statement_let =
+                    std::get_if<node::StmtLet*>(&statement->var)) {
+                if (!(*statement_let)->is_mutable &&
+                    constant_value((*statement_let)->var).has_value()) {
+                    continue;
+                }
+            } else {
+                for_each_scope(statement, [&](node::Scope* scope) {
+                    scope->statements = remove_declarations(scope->statements);
+                });
+            }
+
+            statements[kept++] = statement;
+        }
+
+        return statements.first(kept);
+    }
+
+    // Call `visit` with every scope directly nested in `statement`
+    template <typename Visit>
+    static void for_each_scope(const node::Stmt* statement, Visit visit) {
+        if (const auto scope = std::get_if<node::Scope*>(&statement->var)) {
+            visit(*scope);
+        } else if (const auto stmt_if =
+                       std::get_if<node::StmtIf*>(&statement->var)) {
+            visit((*stmt_if)->if_branch->scope);
+            for (node::ElifBranch* elif_branch : (*stmt_if)->elif_branches) {
+                visit(elif_branch->scope);
+            }
+            if ((*stmt_if)->else_branch.has_value()) {
+                visit((*stmt_if)->else_branch.value()->scope);
+            }
+        }
+    }
+
+    node::Prog& m_prog;
+    const ConstantFolder m_folder;
+    std::vector<node::ExprId> m_initializers;  // Indexed by VarId
+};
\ No newline at end of file
@@ -0,0 +1,308 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// Vectorized scanning of character runs for the Tokenizer. Every kernel is
+// written once as a template over a block classifier: the classifier turns
+// `width` source bytes into a bitmask, the template walks the source block by
+// block and finishes the tail one byte at a time. The scalar kernels are the
+// same templates with a block width of zero.
+namespace scan {
+
+// Character classes, matching std::isspace / std::isdigit / std::isalnum in
+// the "C" locale
+constexpr bool is_space(const char c) {
+    return c == ' ' || static_cast<unsigned char>(c - '\t') <= '\r' - '\t';
+}
+
+constexpr bool is_digit(const char c) {
+    return static_cast<unsigned char>(c - '0') <= 9;
+}
+
+constexpr bool is_alnum(const char c) {
+    return is_digit(c) || static_cast<unsigned char>((c | 0x20) - 'a') <= 25;
+}
+
+struct Scalar {
+    static constexpr size_t width = 0;
+};
+
+#if defined(__x86_64__)
+struct Sse2 {
+    static constexpr size_t width = 16;
+
+    static uint32_t mask(const __m128i bytes) {
+        return static_cast<uint32_t>(_mm_movemask_epi8(bytes));
+    }
+
+    // Unsigned `byte - low <= high - low` for every byte
+    static __m128i in_range(const __m128i bytes, const char low,
+                            const char high) {
+        const __m128i offset = _mm_sub_epi8(bytes, _mm_set1_epi8(low));
+        const __m128i limit = _mm_set1_epi8(static_cast<char>(high - low));
+        return _mm_cmpeq_epi8(_mm_min_epu8(offset, limit), offset);
+    }
+
+    static __m128i load(const char* p) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    }
+
+    static uint32_t equal(const char* p, const char c) {
+        return mask(_mm_cmpeq_epi8(load(p), _mm_set1_epi8(c)));
+    }
+
+    static uint32_t space(const char* p) {
+        const __m128i bytes = load(p);
+        return mask(_mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')),
+                                 in_range(bytes, '\t', '\r')));
+    }
+
+    static uint32_t digit(const char* p) {
+        return mask(in_range(load(p), '0', '9'));
+    }
+
+    static uint32_t alnum(const char* p) {
+        const __m128i bytes = load(p);
+        const __m128i lower = _mm_or_si128(bytes, _mm_set1_epi8(0x20));
+        return mask(_mm_or_si128(in_range(bytes, '0', '9'),
+                                 in_range(lower, 'a', 'z')));
+    }
+};
+
+// The member functions are only ever inlined into the [[gnu::target("avx2")]]
+// entry points below
+struct Avx2 {
+    static constexpr size_t width = 32;
+
+    [[gnu::target("avx2")]] static uint32_t mask(const __m256i bytes) {
+        return static_cast<uint32_t>(_mm256_movemask_epi8(bytes));
+    }
+
+    [[gnu::target("avx2")]] static __m256i in_range(const __m256i bytes,
+                                                    const char low,
+                                                    const char high) {
+        const __m256i offset = _mm256_sub_epi8(bytes, _mm256_set1_epi8(low));
+        const __m256i limit = _mm256_set1_epi8(static_cast<char>(high - low));
+        return _mm256_cmpeq_epi8(_mm256_min_epu8(offset, limit), offset);
+    }
+
+    [[gnu::target("avx2")]] static __m256i load(const char* p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+
+    [[gnu::target("avx2")]] static uint32_t equal(const char* p,
+                                                  const char c) {
+        return mask(_mm256_cmpeq_epi8(load(p), _mm256_set1_epi8(c)));
+    }
+
+    [[gnu::target("avx2")]] static uint32_t space(const char* p) {
+        const __m256i bytes = load(p);
+        return mask(
+            _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' ')),
+                            in_range(bytes, '\t', '\r')));
+    }
+
+    [[gnu::target("avx2")]] static uint32_t digit(const char* p) {
+        return mask(in_range(load(p), '0', '9'));
+    }
+
+    [[gnu::target("avx2")]] static uint32_t alnum(const char* p) {
+        const __m256i bytes = load(p);
+        const __m256i lower = _mm256_or_si256(bytes, _mm256_set1_epi8(0x20));
+        return mask(_mm256_or_si256(in_range(bytes, '0', '9'),
+                                    in_range(lower, 'a', 'z')));
+    }
+};
+#endif
+
+// Bitmask with the lowest `width` bits set
+template <typename Isa>
+constexpr uint32_t block_bits() {
+    return Isa::width == 32 ? ~uint32_t{0} : (uint32_t{1} << Isa::width) - 1;
+}
+
+/**
+ * @brief Skip whitespace starting at `p`, returns the first other character
+ * or `end`
+ */
+template <typename Isa>
+const char* skip_space(const char* p, const char* end) {
+    if constexpr (Isa::width != 0) {
+        while (static_cast<size_t>(end - p) >= Isa::width) {
+            if (const uint32_t other = ~Isa::space(p) & block_bits<Isa>()) {
+                return p + std::countr_zero(other);
+            }
+            p += Isa::width;
+        }
+    }
+
+    while (p < end && is_space(*p)) p++;
+    return p;
+}
+
+/**
+ * @brief Find the first `c` starting at `p`, returns `end` if there is none
+ */
+template <typename Isa>
+const char* find_byte(const char* p, const char* end, const char c) {
+    if constexpr (Isa::width != 0) {
+        while (static_cast<size_t>(end - p) >= Isa::width) {
+            if (const uint32_t found = Isa::equal(p, c)) {
+                return p + std::countr_zero(found);
+            }
+            p += Isa::width;
+        }
+    }
+
+    while (p < end && *p != c) p++;
+    return p;
+}
+
+/**
+ * @brief Find the `*` of the first `*` `/` pair starting at `p`, returns `end`
+ * if the comment is not terminated
+ */
+template <typename Isa>
+const char* find_comment_end(const char* p, const char* end) {
+    if constexpr (Isa::width != 0) {
+        // The second load looks one byte ahead
+        while (static_cast<size_t>(end - p) > Isa::width) {
+            if (const uint32_t found =
+                    Isa::equal(p, '*') & Isa::equal(p + 1, '/')) {
+                return p + std::countr_zero(found);
+            }
+            p += Isa::width;
+        }
+    }
+
+    for (; p < end; p++) {
+        if (*p == '*' && p + 1 < end && p[1] == '/') return p;
+    }
+    return end;
+}
+
+/**
+ * @brief Skip letters and digits starting at `p`
+ */
+template <typename Isa>
+const char* skip_alnum(const char* p, const char* end) {
+    if constexpr (Isa::width != 0) {
+        while (static_cast<size_t>(end - p) >= Isa::width) {
+            if (const uint32_t other = ~Isa::alnum(p) & block_bits<Isa>()) {
+                return p + std::countr_zero(other);
+            }
+            p += Isa::width;
+        }
+    }
+
+    while (p < end && is_alnum(*p)) p++;
+    return p;
+}
+
+/**
+ * @brief Skip digits starting at `p`
+ */
+template <typename Isa>
+const char* skip_digits(const char* p, const char* end) {
+    if constexpr (Isa::width != 0) {
+        while (static_cast<size_t>(end - p) >= Isa::width) {
+            if (const uint32_t other = ~Isa::digit(p) & block_bits<Isa>()) {
+                return p + std::countr_zero(other);
+            }
+            p += Isa::width;
+        }
+    }
+
+    while (p < end && is_digit(*p)) p++;
+    return p;
+}
+
+#if defined(__x86_64__)
+// Entry points of the AVX2 kernels. `flatten` inlines the templates and the
+// Avx2 classifiers into these functions, which is where the target matches.
+[[gnu::target("avx2"), gnu::flatten]] inline const char* avx2_skip_space(
+    const char* p, const char* end) {
+    return skip_space<Avx2>(p, end);
+}
+
+[[gnu::target("avx2"), gnu::flatten]] inline const char* avx2_find_byte(
+    const char* p, const char* end, const char c) {
+    return find_byte<Avx2>(p, end, c);
+}
+
+[[gnu::target("avx2"), gnu::flatten]] inline const char* avx2_find_comment_end(
+    const char* p, const char* end) {
+    return find_comment_end<Avx2>(p, end);
+}
+
+[[gnu::target("avx2"), gnu::flatten]] inline const char* avx2_skip_alnum(
+    const char* p, const char* end) {
+    return skip_alnum<Avx2>(p, end);
+}
+
+[[gnu::target("avx2"), gnu::flatten]] inline const char* avx2_skip_digits(
+    const char* p, const char* end) {
+    return skip_digits<Avx2>(p, end);
+}
+#endif
+
+enum class Isa {
+    Scalar,
+    Sse2,
+    Avx2,
+};
+
+struct Kernels {
+    const char* (*skip_space)(const char*, const char*);
+    const char* (*find_byte)(const char*, const char*, char);
+    const char* (*find_comment_end)(const char*, const char*);
+    const char* (*skip_alnum)(const char*, const char*);
+    const char* (*skip_digits)(const char*, const char*);
+};
+
+/**
+ * @brief The widest instruction set the running CPU supports
+ */
+inline Isa best_isa() {
+#if defined(__x86_64__)
+    static const Isa isa =
+        __builtin_cpu_supports("avx2") ? Isa::Avx2 : Isa::Sse2;
+    return isa;
+#else
+    return Isa::Scalar;
+#endif
+}
+
+/**
+ * @brief Kernels for `isa`, falls back to the scalar kernels if the
+ * instruction set is not available in this build
+ */
+inline const Kernels& kernels(const Isa isa) {
+    static constexpr Kernels scalar{
+        skip_space<Scalar>, find_byte<Scalar>, find_comment_end<Scalar>,
+        skip_alnum<Scalar>, skip_digits<Scalar>};
+#if defined(__x86_64__)
+    static constexpr Kernels sse2{skip_space<Sse2>, find_byte<Sse2>,
+                                  find_comment_end<Sse2>, skip_alnum<Sse2>,
+                                  skip_digits<Sse2>};
+    static constexpr Kernels avx2{avx2_skip_space, avx2_find_byte,
+                                  avx2_find_comment_end, avx2_skip_alnum,
+                                  avx2_skip_digits};
+    switch (isa) {
+        case Isa::Sse2:
+            return sse2;
+        case Isa::Avx2:
+            return avx2;
+        default:
+            break;
+    }
+#endif
+    return scalar;
+}
+}  // namespace scan
\ No newline at end of file
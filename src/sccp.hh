@@ -0,0 +1,252 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "fold.hh"
+#include "ir.hh"
+
+/**
+ * @brief Sparse conditional constant propagation over the SSA form
+ *
+ * A block is executable once an executable predecessor may branch to it, and
+ * a phi only merges the values coming from executable edges, so a value that
+ * is constant along every reachable path is found even when other paths would
+ * disagree. All jumps go forward, so one sweep in layout order sees every
+ * predecessor before its successors and reaches the fixed point.
+ *
+ * The constants then replace their registers, branches on a constant become
+ * jumps, and the blocks that cannot execute are emptied, for simplify-cfg to
+ * remove. A division that would trap is never folded.
+ */
+class SparseConditionalPropagator {
+   public:
+    explicit SparseConditionalPropagator(ir::Program& program)
+        : m_program(program) {}
+
+    void propagate() {
+        const std::vector<ir::Block>& blocks = m_program.blocks;
+        m_values.assign(m_program.reg_count, Value{});
+        m_executable.assign(blocks.size(), false);
+        m_executable[0] = true;
+
+        for (ir::BlockId id = 0; id < blocks.size(); id++) {
+            if (m_executable[id]) {
+                visit(id);
+            }
+        }
+
+        m_replacements.reserve(m_program.reg_count);
+        for (ir::Reg reg = 0; reg < m_program.reg_count; reg++) {
+            m_replacements.push_back(ir::Operand::of_reg(reg));
+        }
+        for (ir::BlockId id = 0; id < blocks.size(); id++) {
+            rewrite(id);
+        }
+    }
+
+   private:
+    // Lattice value of a register: unknown until its definition executes,
+    // then a constant, or varying once it may hold more than one value
+    struct Value {
+        enum class State : uint8_t {
+            Unknown,
+            Constant,
+            Varying,
+        };
+
+        State state{State::Unknown};
+        int64_t constant{0};
+
+        static Value of_constant(const int64_t constant) {
+            return Value{State::Constant, constant};
+        }
+
+        static Value varying() { return Value{State::Varying}; }
+
+        [[nodiscard]] bool is_constant() const {
+            return state == State::Constant;
+        }
+
+        // Greatest lower bound of the two values
+        [[nodiscard]] Value meet(const Value& other) const {
+            if (state == State::Unknown) {
+                return other;
+            }
+            if (other.state == State::Unknown) {
+                return *this;
+            }
+            if (is_constant() && other.is_constant() &&
+                constant == other.constant) {
+                return *this;
+            }
+            return varying();
+        }
+    };
+
+    [[nodiscard]] Value value_of(const ir::Operand& operand) const {
+        return operand.is_imm() ? Value::of_constant(operand.imm)
+                                : m_values[operand.reg];
+    }
+
+    void visit(const ir::BlockId id) {
+        const ir::Block& block = m_program.blocks[id];
+        for (const ir::Phi& phi : block.phis) {
+            Value value;
+            for (const auto& [predecessor, incoming] : phi.incoming) {
+                if (edge_executable(predecessor, id)) {
+                    value = value.meet(value_of(incoming));
+                }
+            }
+            m_values[phi.dst] = value;
+        }
+
+        for (const ir::Inst& inst : block.insts) {
+            if (inst.is_binary()) {
+                m_values[inst.dst] = evaluate(inst);
+            } else if (inst.op == ir::Op::Copy) {
+                m_values[inst.dst] = value_of(inst.a);
+            } else if (inst.op == ir::Op::Load) {
+                m_values[inst.dst] = Value::varying();
+            }
+        }
+
+        const ir::Terminator& terminator = block.terminator;
+        if (terminator.kind == ir::Terminator::Kind::Jump) {
+            m_executable[terminator.target] = true;
+        } else if (terminator.kind == ir::Terminator::Kind::Branch) {
+            m_executable[terminator.target] =
+                m_executable[terminator.target] ||
+                edge_executable(id, terminator.target);
+            m_executable[terminator.other] =
+                m_executable[terminator.other] ||
+                edge_executable(id, terminator.other);
+        }
+    }
+
+    Value evaluate(const ir::Inst& inst) const {
+        const Value left = value_of(inst.a);
+        const Value right = value_of(inst.b);
+        if (left.is_constant() && right.is_constant()) {
+            if (const auto result = evaluate_binary(
+                    expr_kind(inst.op), left.constant, right.constant)) {
+                return Value::of_constant(result.value());
+            }
+            return Value::varying();
+        }
+        if (left.state == Value::State::Unknown ||
+            right.state == Value::State::Unknown) {
+            return Value{};
+        }
+        return Value::varying();
+    }
+
+    static node::ExprKind expr_kind(const ir::Op op) {
+        switch (op) {
+            case ir::Op::Add:
+                return node::ExprKind::Add;
+            case ir::Op::Sub:
+                return node::ExprKind::Sub;
+            case ir::Op::Mul:
+                return node::ExprKind::Mul;
+            default:
+                return node::ExprKind::Div;
+        }
+    }
+
+    // Whether control may go from the executable block `from` to `to`. A
+    // branch on a value not known yet may go either way.
+    [[nodiscard]] bool edge_executable(const ir::BlockId from,
+                                       const ir::BlockId to) const {
+        if (!m_executable[from]) {
+            return false;
+        }
+
+        const ir::Terminator& terminator = m_program.blocks[from].terminator;
+        if (terminator.kind == ir::Terminator::Kind::Jump) {
+            return terminator.target == to;
+        }
+        if (terminator.kind != ir::Terminator::Kind::Branch) {
+            return false;
+        }
+
+        const Value condition = value_of(terminator.value);
+        if (condition.is_constant()) {
+            return (condition.constant != 0 ? terminator.target
+                                            : terminator.other) == to;
+        }
+        return terminator.target == to || terminator.other == to;
+    }
+
+    void replace(ir::Operand& operand) const {
+        if (!operand.is_reg()) {
+            return;
+        }
+        if (m_values[operand.reg].is_constant()) {
+            operand = ir::Operand::of_imm(m_values[operand.reg].constant);
+        } else {
+            operand = m_replacements[operand.reg];
+        }
+    }
+
+    void rewrite(const ir::BlockId id) {
+        ir::Block& block = m_program.blocks[id];
+        if (!m_executable[id]) {
+            block = ir::Block{};
+            return;
+        }
+
+        size_t kept_phis = 0;
+        for (ir::Phi& phi : block.phis) {
+            if (m_values[phi.dst].is_constant()) {
+                continue;
+            }
+
+            std::erase_if(phi.incoming, [&](const auto& incoming) {
+                return !edge_executable(incoming.first, id);
+            });
+            for (auto& incoming : phi.incoming) {
+                replace(incoming.second);
+            }
+            // A phi whose remaining values agree is that value
+            const ir::Operand first = phi.incoming.front().second;
+            if (std::all_of(phi.incoming.begin() + 1, phi.incoming.end(),
+                            [&](const auto& incoming) {
+                                return incoming.second == first;
+                            })) {
+                m_replacements[phi.dst] = first;
+                continue;
+            }
+            block.phis[kept_phis++] = std::move(phi);
+        }
+        block.phis.resize(kept_phis);
+
+        size_t kept = 0;
+        for (ir::Inst& inst : block.insts) {
+            if (inst.dst != ir::none && m_values[inst.dst].is_constant()) {
+                continue;
+            }
+            replace(inst.a);
+            replace(inst.b);
+            block.insts[kept++] = inst;
+        }
+        block.insts.resize(kept);
+
+        ir::Terminator& terminator = block.terminator;
+        replace(terminator.value);
+        if (terminator.kind == ir::Terminator::Kind::Branch &&
+            terminator.value.is_imm()) {
+            terminator = ir::Terminator{
+                ir::Terminator::Kind::Jump, ir::Operand::of_imm(0),
+                terminator.value.imm != 0 ? terminator.target
+                                          : terminator.other};
+        }
+    }
+
+    ir::Program& m_program;
+    std::vector<Value> m_values;  // Indexed by Reg
+    std::vector<bool> m_executable;
+    // Operand standing for each register that is not a constant
+    std::vector<ir::Operand> m_replacements;
+};
\ No newline at end of file
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "error.hh"
+#include "interner.hh"
+#include "parser.hh"
+
+/**
+ * @brief Resolves every identifier and assignment to the variable it refers
+ * to, and checks declarations and mutability, between the parser and the
+ * generator
+ *
+ * Symbol IDs are dense, so the innermost binding of each symbol is kept in a
+ * table indexed by SymbolId instead of a hash map. A declaration that shadows
+ * an outer binding saves it on an undo log, and leaving a scope restores the
+ * bindings saved since the scope was entered. Every lookup and declaration is
+ * O(1).
+ */
+class SemanticAnalyzer {
+   public:
+    SemanticAnalyzer(node::Prog& prog, const std::string_view src,
+                     const Interner& interner)
+        : m_prog(prog), m_src(src), m_interner(interner) {
+        m_bindings.resize(m_interner.size(), node::unresolved_var);
+    }
+
+    /**
+     * @brief Annotate the identifiers, lets and assignments of the program
+     * with their VarId
+     */
+    void analyze() {
+        begin_scope();
+        for (node::Stmt* statement : m_prog.statements) {
+            analyze_stmt(statement);
+        }
+        end_scope();
+
+        m_prog.variable_count = m_variables.size();
+    }
+
+   private:
+    void analyze_expr(const node::ExprId root) {
+        // The operands are visited in no particular order, as expressions do
+        // not declare anything
+        m_expr_stack.push_back(root);
+        while (!m_expr_stack.empty()) {
+            node::Expr& expression = m_prog.expressions[m_expr_stack.back()];
+            m_expr_stack.pop_back();
+
+            switch (expression.kind) {
+                case node::ExprKind::IntLit:
+                    break;
+                case node::ExprKind::Ident:
+                    expression.variable.var = resolve(
+                        expression.variable.symbol, expression.offset);
+                    break;
+                case node::ExprKind::Add:
+                case node::ExprKind::Sub:
+                case node::ExprKind::Mul:
+                case node::ExprKind::Div:
+                    m_expr_stack.push_back(expression.operands.left);
+                    m_expr_stack.push_back(expression.operands.right);
+                    break;
+            }
+        }
+    }
+
+    void analyze_scope(const node::Scope* scope) {
+        begin_scope();
+        for (node::Stmt* statement : scope->statements) {
+            analyze_stmt(statement);
+        }
+        end_scope();
+    }
+
+    void analyze_stmt(node::Stmt* statement) {
+        struct StmtVisitor {
+            SemanticAnalyzer& analyzer;
+
+            void operator()(const node::StmtExit* statement_exit) const {
+                analyzer.analyze_expr(statement_exit->expression);
+            }
+
+            void operator()(const node::StmtArg* statement_print) const {
+                if (const auto* expression =
+                        std::get_if<node::ExprId>(&statement_print->var)) {
+                    analyzer.analyze_expr(*expression);
+                }
+            }
+
+            void operator()(node::StmtLet* statement_let) const {
+                // The initializer still sees the bindings from before the
+                // declaration
+                analyzer.analyze_expr(statement_let->expression);
+                statement_let->var = analyzer.declare(statement_let);
+            }
+
+            void operator()(node::StmtAssign* statement_assign) const {
+                statement_assign->var = analyzer.resolve(
+                    statement_assign->symbol, statement_assign->offset);
+
+                if (!analyzer.m_variables[statement_assign->var].is_mutable) {
+                    ErrorManager::error_expected(ErrorCode::VariableNotMutable,
+                                                 analyzer.m_src,
+                                                 statement_assign->offset);
+                }
+
+                analyzer.analyze_expr(statement_assign->expression);
+            }
+
+            void operator()(const node::Scope* scope) const {
+                analyzer.analyze_scope(scope);
+            }
+
+            void operator()(const node::StmtIf* statement_if) const {
+                analyzer.analyze_expr(statement_if->if_branch->condition);
+                analyzer.analyze_scope(statement_if->if_branch->scope);
+
+                for (const auto& elif_branch : statement_if->elif_branches) {
+                    analyzer.analyze_expr(elif_branch->condition);
+                    analyzer.analyze_scope(elif_branch->scope);
+                }
+
+                if (statement_if->else_branch.has_value()) {
+                    analyzer.analyze_scope(
+                        statement_if->else_branch.value()->scope);
+                }
+            }
+        };
+
+        std::visit(StmtVisitor{*this}, statement->var);
+    }
+
+    node::VarId resolve(const SymbolId symbol, const size_t offset) const {
+        const node::VarId var = m_bindings[symbol];
+        if (var == node::unresolved_var) {
+            ErrorManager::error_expected(ErrorCode::VariableNotDeclared, m_src,
+                                         offset, m_interner.name(symbol));
+        }
+
+        return var;
+    }
+
+    node::VarId declare(const node::StmtLet* statement_let) {
+        const node::VarId shadowed = m_bindings[statement_let->symbol];
+        if (shadowed != node::unresolved_var &&
+            m_variables[shadowed].scope == m_scope_starts.size()) {
+            ErrorManager::error_expected(ErrorCode::VariableAlreadyDeclared,
+                                         m_src, statement_let->offset);
+        }
+
+        const auto var = static_cast<node::VarId>(m_variables.size());
+        m_variables.push_back(
+            Variable{statement_let->is_mutable, m_scope_starts.size()});
+        m_undo_log.push_back(Binding{statement_let->symbol, shadowed});
+        m_bindings[statement_let->symbol] = var;
+        return var;
+    }
+
+    void begin_scope() { m_scope_starts.push_back(m_undo_log.size()); }
+
+    void end_scope() {
+        // Restore the bindings shadowed by the scope's declarations, latest
+        // first
+        while (m_undo_log.size() > m_scope_starts.back()) {
+            const Binding& binding = m_undo_log.back();
+            m_bindings[binding.symbol] = binding.var;
+            m_undo_log.pop_back();
+        }
+        m_scope_starts.pop_back();
+    }
+
+    struct Variable {
+        bool is_mutable;
+        size_t scope;  // Depth of the declaring scope, starting at 1
+    };
+
+    struct Binding {
+        SymbolId symbol;
+        node::VarId var;
+    };
+
+    node::Prog& m_prog;
+    // Source and identifiers m_prog refers to, for diagnostics
+    const std::string_view m_src;
+    const Interner& m_interner;
+
+    std::vector<node::VarId> m_bindings;  // Innermost binding per SymbolId
+    std::vector<Variable> m_variables;    // Indexed by VarId
+    std::vector<Binding> m_undo_log;      // Bindings shadowed, per scope
+    std::vector<size_t> m_scope_starts;   // Undo log size at scope entry
+    std::vector<node::ExprId> m_expr_stack;
+};
\ No newline at end of file
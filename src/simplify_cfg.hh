@@ -0,0 +1,108 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "ir.hh"
+
+/**
+ * @brief Removes the blocks that cannot be reached from the entry, and merges
+ * every block that is only reached by a jump from its predecessor into it
+ *
+ * Branches on a constant become jumps first. All jumps go forward, so a
+ * single sweep in layout order sees the predecessors of a block before the
+ * block itself. The kept blocks stay in layout order.
+ */
+class CfgSimplifier {
+   public:
+    explicit CfgSimplifier(ir::Program& program) : m_program(program) {}
+
+    void simplify() {
+        std::vector<ir::Block>& blocks = m_program.blocks;
+        std::vector<uint32_t> predecessors(blocks.size(), 0);
+        std::vector<bool> kept(blocks.size(), false);
+        kept[0] = true;
+
+        for (ir::BlockId id = 0; id < blocks.size(); id++) {
+            if (!kept[id]) {
+                continue;
+            }
+
+            ir::Terminator& terminator = blocks[id].terminator;
+            if (terminator.kind == ir::Terminator::Kind::Branch &&
+                (terminator.value.is_imm() ||
+                 terminator.target == terminator.other)) {
+                const bool taken =
+                    terminator.value.is_reg() || terminator.value.imm != 0;
+                terminator = ir::Terminator{
+                    ir::Terminator::Kind::Jump, ir::Operand::of_imm(0),
+                    taken ? terminator.target : terminator.other};
+            }
+
+            for_each_successor(terminator, [&](const ir::BlockId successor) {
+                predecessors[successor]++;
+                kept[successor] = true;
+            });
+        }
+
+        for (ir::BlockId id = 0; id < blocks.size(); id++) {
+            if (!kept[id]) {
+                continue;
+            }
+
+            // The merged block's successors keep their predecessor count,
+            // as the jump into it is gone
+            while (blocks[id].terminator.kind == ir::Terminator::Kind::Jump &&
+                   predecessors[blocks[id].terminator.target] == 1) {
+                ir::Block& next = blocks[blocks[id].terminator.target];
+                kept[blocks[id].terminator.target] = false;
+                blocks[id].insts.insert(blocks[id].insts.end(),
+                                        next.insts.begin(), next.insts.end());
+                blocks[id].terminator = next.terminator;
+            }
+        }
+
+        compact(kept);
+    }
+
+   private:
+    template <typename Visit>
+    static void for_each_successor(const ir::Terminator& terminator,
+                                   Visit visit) {
+        if (terminator.kind == ir::Terminator::Kind::Jump) {
+            visit(terminator.target);
+        } else if (terminator.kind == ir::Terminator::Kind::Branch) {
+            visit(terminator.target);
+            visit(terminator.other);
+        }
+    }
+
+    // Drop the blocks that are not kept and renumber the others
+    void compact(const std::vector<bool>& kept) {
+        std::vector<ir::Block>& blocks = m_program.blocks;
+        std::vector<ir::BlockId> renumbered(blocks.size(), ir::none);
+        ir::BlockId count = 0;
+        for (ir::BlockId id = 0; id < blocks.size(); id++) {
+            if (kept[id]) {
+                renumbered[id] = count;
+                if (count != id) {
+                    blocks[count] = std::move(blocks[id]);
+                }
+                count++;
+            }
+        }
+        blocks.resize(count);
+
+        for (ir::Block& block : blocks) {
+            ir::Terminator& terminator = block.terminator;
+            if (terminator.target != ir::none) {
+                terminator.target = renumbered[terminator.target];
+            }
+            if (terminator.other != ir::none) {
+                terminator.other = renumbered[terminator.other];
+            }
+        }
+    }
+
+    ir::Program& m_program;
+};
\ No newline at end of file
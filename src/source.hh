@@ -0,0 +1,134 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "scan.hh"
+
+/**
+ * @brief Read-only memory mapping of a source file
+ *
+ * Tokens refer to the mapped bytes through std::string_view, so a SourceFile
+ * has to outlive the Tokenizer, the Parser and the Generator.
+ */
+class SourceFile {
+   public:
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+
+    SourceFile(SourceFile&& other) noexcept
+        : m_data{std::exchange(other.m_data, nullptr)},
+          m_size{std::exchange(other.m_size, 0)} {}
+
+    SourceFile& operator=(SourceFile&& other) noexcept {
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+        return *this;
+    }
+
+    ~SourceFile() {
+        if (m_data != nullptr) {
+            munmap(m_data, m_size);
+        }
+    }
+
+    /**
+     * @brief Map the file at `path` into memory, returns std::nullopt if the
+     * file cannot be opened or mapped
+     */
+    static std::optional<SourceFile> open(const char* path) {
+        const int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            return std::nullopt;
+        }
+
+        struct stat file_stat {};
+        if (fstat(fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) {
+            close(fd);
+            return std::nullopt;
+        }
+
+        const auto size = static_cast<size_t>(file_stat.st_size);
+        if (size == 0) {
+            // mmap does not accept empty mappings, an empty file is simply an
+            // empty program
+            close(fd);
+            return SourceFile{nullptr, 0};
+        }
+
+        void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        // The mapping keeps its own reference to the file
+        close(fd);
+        if (data == MAP_FAILED) {
+            return std::nullopt;
+        }
+
+        // The tokenizer reads the source front to back exactly once
+        madvise(data, size, MADV_SEQUENTIAL);
+
+        return SourceFile{data, size};
+    }
+
+    [[nodiscard]] std::string_view contents() const {
+        if (m_data == nullptr) {
+            return {};
+        }
+
+        return {static_cast<const char*>(m_data), m_size};
+    }
+
+   private:
+    SourceFile(void* data, const size_t size) : m_data{data}, m_size{size} {}
+
+    void* m_data;
+    size_t m_size;
+};
+
+/**
+ * @brief Offsets of the line starts in a source, used to turn a token offset
+ * into a line and a column. Tokens do not carry a location themselves, the
+ * table is only built when a diagnostic is reported.
+ */
+class LineTable {
+   public:
+    struct Location {
+        size_t line;    // Starting at 1
+        size_t column;  // Starting at 1
+    };
+
+    explicit LineTable(const std::string_view src) {
+        const scan::Kernels& kernels = scan::kernels(scan::best_isa());
+        const char* const end = src.data() + src.size();
+
+        m_line_starts.push_back(0);
+        const char* p = kernels.find_byte(src.data(), end, '\n');
+        while (p != end) {
+            m_line_starts.push_back(static_cast<size_t>(p + 1 - src.data()));
+            p = kernels.find_byte(p + 1, end, '\n');
+        }
+    }
+
+    [[nodiscard]] Location locate(const size_t offset) const {
+        // The last line start at or before the offset
+        const auto line = std::upper_bound(m_line_starts.cbegin(),
+                                           m_line_starts.cend(), offset) -
+                          m_line_starts.cbegin();
+        const size_t line_start = m_line_starts[static_cast<size_t>(line) - 1];
+        return {static_cast<size_t>(line), offset - line_start + 1};
+    }
+
+    [[nodiscard]] size_t size() const { return m_line_starts.size(); }
+
+   private:
+    std::vector<size_t> m_line_starts;
+};
\ No newline at end of file
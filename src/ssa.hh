@@ -0,0 +1,166 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "ir.hh"
+
+/**
+ * @brief Puts the program in SSA form: removes every load and store, and
+ * gives each use of a slot the register or constant last stored to it
+ *
+ * The value of a slot is looked up on demand, walking back through the
+ * predecessors of the block until a store. Where control flow joins and the
+ * predecessors disagree, a phi merges their values at the start of the block.
+ * All jumps go forward, so the predecessors of a block are in SSA form before
+ * the block itself, and no phi is ever needed for a value that only one
+ * path defines.
+ */
+class SsaBuilder {
+   public:
+    explicit SsaBuilder(ir::Program& program) : m_program(program) {}
+
+    void build() {
+        std::vector<ir::Block>& blocks = m_program.blocks;
+        m_predecessors = ir::predecessors(blocks);
+        m_replacements.reserve(m_program.reg_count);
+        for (ir::Reg reg = 0; reg < m_program.reg_count; reg++) {
+            m_replacements.push_back(ir::Operand::of_reg(reg));
+        }
+
+        for (ir::BlockId id = 0; id < blocks.size(); id++) {
+            size_t kept = 0;
+            for (ir::Inst& inst : blocks[id].insts) {
+                replace(inst.a);
+                replace(inst.b);
+                if (inst.op == ir::Op::Load) {
+                    m_replacements[inst.dst] = read(id, inst.index);
+                } else if (inst.op == ir::Op::Store) {
+                    m_values.insert_or_assign(key(id, inst.index), inst.a);
+                } else {
+                    blocks[id].insts[kept++] = inst;
+                }
+            }
+            blocks[id].insts.resize(kept);
+            replace(blocks[id].terminator.value);
+        }
+    }
+
+   private:
+    static uint64_t key(const ir::BlockId block, const ir::Slot slot) {
+        return static_cast<uint64_t>(block) << 32 | slot;
+    }
+
+    // Uses of loaded registers become the value that was loaded. Phis are
+    // created after the table, and are never replaced.
+    void replace(ir::Operand& operand) const {
+        if (operand.is_reg() && operand.reg < m_replacements.size()) {
+            operand = m_replacements[operand.reg];
+        }
+    }
+
+    /**
+     * @brief Value of `slot` at the end of `block`, or at the instruction
+     * being rewritten when `block` is the current one
+     *
+     * The blocks whose predecessors are not all resolved yet wait on an
+     * explicit stack, in place of recursion. Every block on the way gets the
+     * value recorded, so each block is resolved once per slot.
+     */
+    ir::Operand read(const ir::BlockId block, const ir::Slot slot) {
+        m_pending.push_back(block);
+        while (!m_pending.empty()) {
+            const ir::BlockId id = m_pending.back();
+            if (m_values.contains(key(id, slot))) {
+                m_pending.pop_back();
+                continue;
+            }
+
+            const std::vector<ir::BlockId>& predecessors = m_predecessors[id];
+            const auto unresolved = std::find_if(
+                predecessors.begin(), predecessors.end(),
+                [&](const ir::BlockId predecessor) {
+                    return !m_values.contains(key(predecessor, slot));
+                });
+            if (unresolved != predecessors.end()) {
+                m_pending.push_back(*unresolved);
+                continue;
+            }
+
+            m_values.emplace(key(id, slot), merge(id, slot));
+            m_pending.pop_back();
+        }
+
+        return m_values.at(key(block, slot));
+    }
+
+    // Value of `slot` at the start of `block`, whose predecessors are all
+    // resolved
+    ir::Operand merge(const ir::BlockId block, const ir::Slot slot) {
+        const std::vector<ir::BlockId>& predecessors = m_predecessors[block];
+        // Only blocks that nothing jumps to read a slot before any store
+        if (predecessors.empty()) {
+            return ir::Operand::of_imm(0);
+        }
+
+        const ir::Operand first = m_values.at(key(predecessors.front(), slot));
+        const bool agree = std::all_of(
+            predecessors.begin() + 1, predecessors.end(),
+            [&](const ir::BlockId predecessor) {
+                return m_values.at(key(predecessor, slot)) == first;
+            });
+        if (agree) {
+            return first;
+        }
+
+        ir::Phi phi{m_program.new_reg(), {}};
+        for (const ir::BlockId predecessor : predecessors) {
+            phi.incoming.emplace_back(predecessor,
+                                      m_values.at(key(predecessor, slot)));
+        }
+        m_program.blocks[block].phis.push_back(std::move(phi));
+        return ir::Operand::of_reg(m_program.blocks[block].phis.back().dst);
+    }
+
+    ir::Program& m_program;
+    std::vector<std::vector<ir::BlockId>> m_predecessors;
+    // Value of a slot at the end of a block, keyed by `key`
+    std::unordered_map<uint64_t, ir::Operand> m_values;
+    // Operand standing for each register that existed before the pass
+    std::vector<ir::Operand> m_replacements;
+    std::vector<ir::BlockId> m_pending;
+};
+
+/**
+ * @brief Takes the program out of SSA form, replacing each phi by a copy to
+ * its register at the end of every predecessor
+ *
+ * The edge from a branch to a join is not split, so the copy also runs when
+ * the branch goes the other way. This is harmless: the register of the phi is
+ * only read after the join, and every path to the join passes through the
+ * copy of the predecessor it arrives from, which comes later in layout order.
+ * As there are no loops, a copy never reads the register of another phi of
+ * the same block, so the copies need no particular order.
+ */
+class SsaDestructor {
+   public:
+    explicit SsaDestructor(ir::Program& program) : m_program(program) {}
+
+    void destruct() {
+        std::vector<ir::Block>& blocks = m_program.blocks;
+        for (ir::Block& block : blocks) {
+            for (const ir::Phi& phi : block.phis) {
+                for (const auto& [predecessor, value] : phi.incoming) {
+                    blocks[predecessor].insts.push_back(
+                        ir::Inst::copy(phi.dst, value));
+                }
+            }
+            block.phis.clear();
+        }
+    }
+
+   private:
+    ir::Program& m_program;
+};
\ No newline at end of file
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <ostream>
+#include <string_view>
+
+// Replacing `mul` and `idiv` by a constant with cheaper instruction
+// sequences. The Generator emits them through gen_mul_by_constant() and
+// gen_div_by_constant(), tests/strength_test.cpp runs them.
+namespace strength {
+
+// |value| as an unsigned number, exact for INT64_MIN as well
+inline uint64_t magnitude(const int64_t value) {
+    return value < 0 ? 0 - static_cast<uint64_t>(value)
+                     : static_cast<uint64_t>(value);
+}
+
+// k if `value` is 2^k, std::nullopt otherwise
+inline std::optional<unsigned> power_of_two(const uint64_t value) {
+    if (!std::has_single_bit(value)) {
+        return std::nullopt;
+    }
+
+    return static_cast<unsigned>(std::countr_zero(value));
+}
+
+/**
+ * @brief Multiplier as `lea rax, [rax + rax * scale]` followed by a left
+ * shift, for the magnitudes 3, 5 and 9 times a power of two
+ */
+struct LeaMultiplier {
+    unsigned scale;  // 2, 4 or 8
+    unsigned shift;
+};
+
+inline std::optional<LeaMultiplier> lea_multiplier(const uint64_t value) {
+    if (value == 0) {
+        return std::nullopt;
+    }
+
+    const auto shift = static_cast<unsigned>(std::countr_zero(value));
+    switch (value >> shift) {
+        case 3:
+            return LeaMultiplier{2, shift};
+        case 5:
+            return LeaMultiplier{4, shift};
+        case 9:
+            return LeaMultiplier{8, shift};
+        default:
+            return std::nullopt;
+    }
+}
+
+/**
+ * @brief Magic number for a signed division by a constant that is not 0, 1,
+ * -1 or a power of two in magnitude (Hacker's Delight, 10-4)
+ *
+ * The quotient x / divisor, truncated toward zero like `idiv`, is
+ *     q = high 64 bits of the signed product multiplier * x
+ *     q += x   if divisor > 0 and multiplier < 0
+ *     q -= x   if divisor < 0 and multiplier > 0
+ *     q = (q >> shift) + (q < 0 ? 1 : 0)   (arithmetic shift)
+ */
+struct DivisionMagic {
+    int64_t multiplier;
+    unsigned shift;
+};
+
+inline DivisionMagic division_magic(const int64_t divisor) {
+    constexpr uint64_t two63 = uint64_t{1} << 63;
+    const uint64_t absolute = magnitude(divisor);
+    const uint64_t t = two63 + (static_cast<uint64_t>(divisor) >> 63);
+    // Largest value whose remainder by |divisor| is |divisor| - 1
+    const uint64_t absolute_nc = t - 1 - t % absolute;
+
+    unsigned p = 63;
+    uint64_t q1 = two63 / absolute_nc;
+    uint64_t r1 = two63 - q1 * absolute_nc;
+    uint64_t q2 = two63 / absolute;
+    uint64_t r2 = two63 - q2 * absolute;
+    uint64_t delta = 0;
+    do {
+        p++;
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= absolute_nc) {
+            q1++;
+            r1 -= absolute_nc;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= absolute) {
+            q2++;
+            r2 -= absolute;
+        }
+        delta = absolute - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    const uint64_t multiplier = divisor < 0 ? 0 - (q2 + 1) : q2 + 1;
+    return DivisionMagic{static_cast<int64_t>(multiplier), p - 64};
+}
+
+// Whether a division by `divisor` is replaced, 0 and -1 are left to `idiv`
+// as they trap for some or all dividends
+inline bool reduces_division(const int64_t divisor) {
+    return divisor != 0 && divisor != -1;
+}
+
+/**
+ * @brief reg *= factor, with shifts and `lea` for the factors they cover
+ *
+ * Only the low 64 bits of the product are kept, as with `mul`, so the
+ * sign of the factor does not change the sequence apart from the `neg`.
+ * Clobbers rbx for the factors that do not fit 32 bits.
+ */
+inline void gen_mul_by_constant(std::ostream& out, const std::string_view reg,
+                                const int64_t factor) {
+    const uint64_t absolute = magnitude(factor);
+    if (absolute == 0) {
+        out << "    xor " << reg << ", " << reg << "\n";
+        return;
+    }
+
+    if (const auto shift = power_of_two(absolute)) {
+        if (shift.value() > 0) {
+            out << "    shl " << reg << ", " << shift.value() << "\n";
+        }
+    } else if (const auto lea = lea_multiplier(absolute)) {
+        out << "    lea " << reg << ", [" << reg << " + " << reg << " * "
+            << lea->scale << "]\n";
+        if (lea->shift > 0) {
+            out << "    shl " << reg << ", " << lea->shift << "\n";
+        }
+    } else if (factor >= std::numeric_limits<int32_t>::min() &&
+               factor <= std::numeric_limits<int32_t>::max()) {
+        out << "    imul " << reg << ", " << reg << ", " << factor << "\n";
+        return;
+    } else {
+        out << "    mov rbx, " << factor << "\n";
+        out << "    imul " << reg << ", rbx\n";
+        return;
+    }
+
+    if (factor < 0) {
+        out << "    neg " << reg << "\n";
+    }
+}
+
+/**
+ * @brief rax /= divisor, truncated toward zero like `idiv`, for a divisor
+ * that reduces_division() accepts. Clobbers rbx and rdx.
+ */
+inline void gen_div_by_constant(std::ostream& out, const int64_t divisor) {
+    assert(reduces_division(divisor));
+    const uint64_t absolute = magnitude(divisor);
+    if (const auto shift = power_of_two(absolute)) {
+        if (shift.value() > 0) {
+            // Negative dividends are biased by 2^shift - 1, so that the
+            // arithmetic shift rounds toward zero instead of down
+            out << "    mov rdx, rax\n";
+            if (shift.value() > 1) {
+                out << "    sar rdx, 63\n";
+            }
+            out << "    shr rdx, " << 64 - shift.value() << "\n";
+            out << "    add rax, rdx\n";
+            out << "    sar rax, " << shift.value() << "\n";
+        }
+        if (divisor < 0) {
+            out << "    neg rax\n";
+        }
+        return;
+    }
+
+    const DivisionMagic magic = division_magic(divisor);
+    out << "    mov rbx, rax\n";
+    out << "    mov rax, " << magic.multiplier << "\n";
+    out << "    imul rbx\n";  // rdx = high half of the product
+    if (divisor > 0 && magic.multiplier < 0) {
+        out << "    add rdx, rbx\n";
+    } else if (divisor < 0 && magic.multiplier > 0) {
+        out << "    sub rdx, rbx\n";
+    }
+    if (magic.shift > 0) {
+        out << "    sar rdx, " << magic.shift << "\n";
+    }
+    // Round a negative quotient toward zero
+    out << "    mov rax, rdx\n";
+    out << "    shr rax, 63\n";
+    out << "    add rax, rdx\n";
+}
+}  // namespace strength
\ No newline at end of file
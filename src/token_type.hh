@@ -1,6 +1,13 @@
 #pragma once
 
-enum class TokenType {
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string_view>
+
+enum class TokenType : uint8_t {
     INT_LIT = 0,  // 123
     STRING_LIT,   // "abc"
     IDENT,        // abc
@@ -29,6 +36,10 @@ enum class TokenType {
     END_OF_LINE,  // ;
 };
 
+// Number of token types, END_OF_LINE has to stay the last enumerator
+constexpr size_t token_type_count =
+    static_cast<size_t>(TokenType::END_OF_LINE) + 1;
+
 /**
  * @brief Convert a TokenType to a string
  */
@@ -108,4 +119,105 @@ inline std::optional<size_t> binary_precedence(const TokenType tokenType) {
         default:
             return std::nullopt;
     }
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Spelling of a keyword token, empty for all other tokens
+ */
+constexpr std::string_view keyword_spelling(const TokenType tokenType) {
+    switch (tokenType) {
+        case TokenType::LET:
+            return "let";
+        case TokenType::MUT:
+            return "mut";
+
+        case TokenType::EXIT:
+            return "exit";
+        case TokenType::PRINT:
+            return "print";
+
+        case TokenType::IF:
+            return "if";
+        case TokenType::ELIF:
+            return "elif";
+        case TokenType::ELSE:
+            return "else";
+
+        default:
+            return {};
+    }
+}
+
+// The keyword table below is a perfect hash generated at compile time from
+// keyword_spelling(). A word is hashed by its length and its first and last
+// character, so recognizing a keyword costs one hash and one compare.
+constexpr size_t keyword_table_size = 16;
+
+struct KeywordSlot {
+    std::string_view spelling;
+    TokenType type;
+};
+
+constexpr size_t keyword_hash(const std::string_view word, const size_t seed) {
+    return (static_cast<unsigned char>(word.front()) * seed +
+            static_cast<unsigned char>(word.back()) + word.size()) &
+           (keyword_table_size - 1);
+}
+
+constexpr bool is_perfect_keyword_seed(const size_t seed) {
+    std::array<bool, keyword_table_size> used{};
+    for (size_t i = 0; i < token_type_count; i++) {
+        const std::string_view spelling =
+            keyword_spelling(static_cast<TokenType>(i));
+        if (spelling.empty()) continue;
+
+        const size_t slot = keyword_hash(spelling, seed);
+        if (used[slot]) return false;
+        used[slot] = true;
+    }
+    return true;
+}
+
+constexpr size_t find_keyword_seed() {
+    for (size_t seed = 1; seed < 1024; seed++) {
+        if (is_perfect_keyword_seed(seed)) return seed;
+    }
+    return 0;
+}
+
+constexpr size_t keyword_seed = find_keyword_seed();
+static_assert(keyword_seed != 0,
+              "No perfect keyword hash found, increase keyword_table_size");
+
+constexpr std::array<KeywordSlot, keyword_table_size> build_keyword_table() {
+    std::array<KeywordSlot, keyword_table_size> table{};
+    for (size_t i = 0; i < token_type_count; i++) {
+        const auto tokenType = static_cast<TokenType>(i);
+        const std::string_view spelling = keyword_spelling(tokenType);
+        if (spelling.empty()) continue;
+
+        table[keyword_hash(spelling, keyword_seed)] = {spelling, tokenType};
+    }
+    return table;
+}
+
+constexpr std::array<KeywordSlot, keyword_table_size> keyword_table =
+    build_keyword_table();
+
+/**
+ * @brief Look up the keyword token for a word, std::nullopt if the word is
+ * not a keyword
+ */
+constexpr std::optional<TokenType> keyword_type(const std::string_view word) {
+    if (word.empty()) return std::nullopt;
+
+    // Empty slots have an empty spelling, which never matches a word
+    const KeywordSlot& slot = keyword_table[keyword_hash(word, keyword_seed)];
+    if (slot.spelling != word) return std::nullopt;
+
+    return slot.type;
+}
+
+static_assert(keyword_type("elif") == TokenType::ELIF);
+static_assert(keyword_type("else") == TokenType::ELSE);
+static_assert(!keyword_type("x").has_value());
\ No newline at end of file
@@ -1,276 +1,258 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
+#include <limits>
 #include <optional>
-#include <string>
+#include <string_view>
 #include <vector>
 
 #include "config.hh"
 #include "error.hh"
+#include "interner.hh"
+#include "scan.hh"
+#include "source.hh"
 #include "token_type.hh"
 
+// A token refers to its characters by position in the source handed to the
+// Tokenizer. String literals are kept as spelled, without the quotes (see
+// unescape()). Line and column are only computed for diagnostics, see
+// LineTable. The value of an integer literal is kept out of the token, so
+// that every token stays 16 bytes: the Tokenizer holds the value of the last
+// literal lexed until the parser copies it into its lookahead window.
 struct Token {
     TokenType type;
-    std::string value;
-    size_t line_number;
-    size_t col_number;
+    uint32_t offset;  // Position of the first character in the source
+    uint32_t length;
+    union {
+        // Interned name of an IDENT token, see Interner
+        SymbolId symbol{};
+        // Index of the value of an INT_LIT token in TokenStream::integers
+        uint32_t literal;
+    };
+
+    [[nodiscard]] std::string_view text(const std::string_view src) const {
+        return src.substr(offset, length);
+    }
+};
+static_assert(sizeof(Token) == 16);
+
+/**
+ * @brief Materialized token stream, stored as struct of arrays of 13 bytes
+ * per token, and the values of the integer literals
+ */
+struct TokenStream {
+    std::vector<TokenType> types;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> lengths;
+    // Symbol of an IDENT token, literal index of an INT_LIT token
+    std::vector<uint32_t> payloads;
+    std::vector<int64_t> integers;  // Indexed by Token::literal
+
+    void push_back(const Token& token) {
+        types.push_back(token.type);
+        offsets.push_back(token.offset);
+        lengths.push_back(token.length);
+        payloads.push_back(token.type == TokenType::INT_LIT ? token.literal
+                                                            : token.symbol);
+    }
+
+    [[nodiscard]] Token operator[](const size_t index) const {
+        Token token{types[index], offsets[index], lengths[index], {}};
+        if (types[index] == TokenType::INT_LIT) {
+            token.literal = payloads[index];
+        } else {
+            token.symbol = payloads[index];
+        }
+        return token;
+    }
+
+    [[nodiscard]] size_t size() const { return types.size(); }
 };
 
+/**
+ * @brief Call `emit` for every character a string literal stands for, given
+ * the literal as spelled in the source without the surrounding quotes. A
+ * backslash is dropped, `\n` becomes a newline.
+ */
+template <typename Emit>
+constexpr void unescape(const std::string_view literal, Emit&& emit) {
+    for (size_t i = 0; i < literal.size(); i++) {
+        if (literal[i] == '\\') {
+            if (i + 1 < literal.size() && literal[i + 1] == 'n') {
+                emit('\n');
+                i++;
+            }
+            continue;
+        }
+
+        emit(literal[i]);
+    }
+}
+
 class Tokenizer {
    public:
-    explicit Tokenizer(const std::string src) : m_src(std::move(src)) {}
+    explicit Tokenizer(const std::string_view src, Interner& interner,
+                       const scan::Isa isa = scan::best_isa())
+        : m_src(src), m_interner(interner), m_scan(scan::kernels(isa)) {
+        // Tokens store 32 bit offsets into the source
+        if (m_src.size() > std::numeric_limits<uint32_t>::max()) {
+            ErrorManager::error(ErrorCode::SourceTooLarge);
+        }
+    }
 
-    std::vector<Token> tokenize() {
-        std::vector<Token> tokens;
-        std::string token_buff;
+    /**
+     * @brief Materialize the whole token stream, the parser pulls tokens
+     * through next_token() instead. The tokenizer is rewound afterwards.
+     */
+    TokenStream tokenize() {
+        TokenStream tokens;
+        while (auto token = next_token()) {
+            if (token->type == TokenType::INT_LIT) {
+                token->literal = static_cast<uint32_t>(tokens.integers.size());
+                tokens.integers.push_back(m_integer);
+            }
+            tokens.push_back(token.value());
+        }
+
+#ifdef DEBUG
+        const LineTable lines(m_src);
+        for (size_t i = 0; i < tokens.size(); i++) {
+            const Token token = tokens[i];
+            const auto location = lines.locate(token.offset);
+            std::cout << "Token: " << token.type << ", Value: `"
+                      << token.text(m_src) << "`, Line: " << location.line
+                      << ", Column: " << location.column << "\n";
+        }
+
+        std::cout << "Tokenization complete\n"
+                  << "file had " << lines.size() << " lines\n";
+#endif
+        rewind();
+        return tokens;
+    }
 
-        // Continue looking for tokens until the end of the source
+    /**
+     * @brief Lex the next token, std::nullopt at the end of the source
+     */
+    std::optional<Token> next_token() {
+        // Skip whitespace and comments until a token starts
         while (peek().has_value()) {
             char c = peek().value();
 
-            // New line
-            if (c == '\n') {
-                handle_new_line();
-                consume();
-                continue;
-            }
-
-            // Skip whitespace
-            if (std::isspace(c)) {
-                consume();
+            // Skip whitespace, including new lines
+            if (scan::is_space(c)) {
+                advance_to(m_scan.skip_space(cursor(), end()));
                 continue;
             }
 
             // Comments
             if (c == '/' && peek(1).has_value() && peek(1).value() == '/') {
-                consume();
-                consume();
-                while (peek().has_value() && peek().value() != '\n') {
-                    consume();
-                }
+                advance_to(m_scan.find_byte(cursor() + 2, end(), '\n'));
                 continue;
             }
             if (c == '/' && peek(1).has_value() && peek(1).value() == '*') {
-                consume();
-                consume();
-                while (peek().has_value()) {
-                    if (peek().value() == '*' && peek(1).value() == '/') {
-                        consume();
-                        consume();
-                        break;
-                    }
-
-                    // Handle new lines in comments
-                    if (peek().value() == '\n') {
-                        handle_new_line();
-                    }
-
-                    consume();
+                const char* comment_end =
+                    m_scan.find_comment_end(cursor() + 2, end());
+                if (comment_end != end()) {
+                    comment_end += 2;
                 }
+                advance_to(comment_end);
                 continue;
             }
 
-            // Identifier
-            if (std::isalpha(c)) {
-                token_buff.push_back(consume());
-                while (peek().has_value() && std::isalnum(peek().value())) {
-                    token_buff.push_back(consume());
-                }
-
-                // Handle keywords
-                if (token_buff == "exit") {
-                    tokens.push_back({TokenType::EXIT, token_buff,
-                                      m_line_number, m_col_number});
-                    token_buff.clear();
-                    continue;
-                }
-
-                if (token_buff == "print") {
-                    tokens.push_back({TokenType::PRINT, token_buff,
-                                      m_line_number, m_col_number});
-                    token_buff.clear();
-                    continue;
-                }
-
-                if (token_buff == "let") {
-                    tokens.push_back({TokenType::LET, token_buff, m_line_number,
-                                      m_col_number});
-                    token_buff.clear();
-                    continue;
-                }
-
-                if (token_buff == "if") {
-                    tokens.push_back({TokenType::IF, token_buff, m_line_number,
-                                      m_col_number});
-                    token_buff.clear();
-                    continue;
-                }
-                if (token_buff == "elif") {
-                    tokens.push_back({TokenType::ELIF, token_buff,
-                                      m_line_number, m_col_number});
-                    token_buff.clear();
-                    continue;
-                }
-                if (token_buff == "else") {
-                    tokens.push_back({TokenType::ELSE, token_buff,
-                                      m_line_number, m_col_number});
-                    token_buff.clear();
-                    continue;
-                }
+            const size_t start = m_index;
 
-                if (token_buff == "mut") {
-                    tokens.push_back({TokenType::MUT, token_buff, m_line_number,
-                                      m_col_number});
-                    token_buff.clear();
-                    continue;
+            // Identifier
+            if (std::isalpha(static_cast<unsigned char>(c))) {
+                advance_to(m_scan.skip_alnum(cursor() + 1, end()));
+                const std::string_view token_buff =
+                    m_src.substr(start, m_index - start);
+
+                // Keywords are looked up in a perfect hash table, anything
+                // else is an identifier
+                if (const auto keyword = keyword_type(token_buff)) {
+                    return make_token(keyword.value(), start);
                 }
 
-                tokens.push_back({TokenType::IDENT, token_buff, m_line_number,
-                                  m_col_number});
-                token_buff.clear();
-                continue;
+                return make_token(TokenType::IDENT, start,
+                                  m_interner.intern(token_buff));
             }
 
             // Numbers
-            if ((c == '-' && std::isdigit(peek(1).value())) ||
-                std::isdigit(c)) {
-                token_buff.push_back(consume());
-                while (peek().has_value()) {
-                    if (peek().value() == '_' && peek(1).has_value() &&
-                        std::isdigit(peek(1).value())) {
-                        consume();
-                        continue;
-                    }
-                    if (!std::isdigit(peek().value())) {
-                        break;
-                    }
-                    token_buff.push_back(consume());
+            if ((c == '-' && peek(1).has_value() &&
+                 scan::is_digit(peek(1).value())) ||
+                scan::is_digit(c)) {
+                const char* digits_end =
+                    m_scan.skip_digits(cursor() + 1, end());
+                // A `_` separator has to be followed by another digit
+                while (digits_end + 1 < end() && *digits_end == '_' &&
+                       scan::is_digit(digits_end[1])) {
+                    digits_end = m_scan.skip_digits(digits_end + 1, end());
                 }
-
-                tokens.push_back({TokenType::INT_LIT, token_buff, m_line_number,
-                                  m_col_number});
-                token_buff.clear();
-                continue;
+                advance_to(digits_end);
+
+                Token token = make_token(TokenType::INT_LIT, start);
+                const std::optional<int64_t> integer =
+                    parse_integer(token.text(m_src));
+                if (!integer.has_value()) {
+                    ErrorManager::error_expected(
+                        ErrorCode::IntegerLiteralOverflow, m_src, start);
+                }
+                m_integer = integer.value();
+                return token;
             }
 
             // Strings
             if (c == '"') {
                 consume();
-                while (peek().has_value() && peek().value() != '"') {
-                    if (peek().value() == '\\' && peek(1).has_value()) {
-                        consume();
-
-                        // Handle escape characters
-                        if (peek().value() == 'n') {
-                            consume();
-                            token_buff.push_back('\n');
-                            continue;
-                        }
-
-                        continue;
-                    }
-
-                    token_buff.push_back(consume());
+                // An escaped quote does not end the literal either, so the
+                // literal always ends at the next quote
+                advance_to(m_scan.find_byte(cursor(), end(), '"'));
+                if (!peek().has_value()) {
+                    ErrorManager::error_expected(ErrorCode::UnterminatedString,
+                                                 m_src, start);
                 }
+                const Token token =
+                    make_token(TokenType::STRING_LIT, start + 1);
                 consume();
-                if (token_buff.size() > MAX_STRING_SIZE) {
-                    std::cerr << ErrorManager::construct_error_message(
-                        ErrorCode::StringTooLong, m_line_number, m_col_number);
 
-                    exit(EXIT_FAILURE);
+                size_t string_size = 0;
+                unescape(token.text(m_src), [&](char) { string_size++; });
+                if (string_size > MAX_STRING_SIZE) {
+                    ErrorManager::error_expected(ErrorCode::StringTooLong,
+                                                 m_src, start);
                 }
-                tokens.push_back({TokenType::STRING_LIT, token_buff,
-                                  m_line_number, m_col_number});
-                token_buff.clear();
-                continue;
+                return token;
             }
 
             // Handle operators
-            if (c == '(') {
-                consume();
-                tokens.push_back(
-                    {TokenType::OPEN_PAREN, "(", m_line_number, m_col_number});
-                continue;
-            }
-            if (c == ')') {
-                consume();
-                tokens.push_back(
-                    {TokenType::CLOSE_PAREN, ")", m_line_number, m_col_number});
-                continue;
-            }
-            if (c == '=') {
-                consume();
-                tokens.push_back(
-                    {TokenType::EQ, "=", m_line_number, m_col_number});
-                continue;
-            }
-            if (c == '+') {
-                consume();
-                tokens.push_back(
-                    {TokenType::PLUS, "+", m_line_number, m_col_number});
-                continue;
-            }
-            if (c == '-') {
-                consume();
-                tokens.push_back(
-                    {TokenType::MINUS, "-", m_line_number, m_col_number});
-                continue;
-            }
-            if (c == '*') {
-                consume();
-                tokens.push_back(
-                    {TokenType::STAR, "*", m_line_number, m_col_number});
-                continue;
-            }
-            if (c == '/') {
-                consume();
-                tokens.push_back({TokenType::FORWARD_SLASH, "/", m_line_number,
-                                  m_col_number});
-                continue;
-            }
-
-            // Handle braces
-            if (c == '{') {
-                consume();
-                tokens.push_back(
-                    {TokenType::OPEN_CURLY, "{", m_line_number, m_col_number});
-                continue;
-            }
-            if (c == '}') {
-                consume();
-                tokens.push_back(
-                    {TokenType::CLOSE_CURLY, "}", m_line_number, m_col_number});
-                continue;
-            }
-
-            // Semicolon, end of line
-            if (c == ';') {
+            const std::optional<TokenType> punctuation = punctuation_type(c);
+            if (punctuation.has_value()) {
                 consume();
-                tokens.push_back(
-                    {TokenType::END_OF_LINE, ";", m_line_number, m_col_number});
-                continue;
+                return make_token(punctuation.value(), start);
             }
 
             // Syntax error, no token found
-            std::cerr << ErrorManager::construct_error_message(
-                ErrorCode::UnidentifiedToken, m_line_number, m_col_number);
-            exit(EXIT_FAILURE);
+            ErrorManager::error_expected(ErrorCode::UnidentifiedToken, m_src,
+                                         start);
         }
 
-#ifdef DEBUG
-        for (const auto& token : tokens) {
-            std::cout << "Token: " << token.type << ", Value: `" << token.value
-                      << "`, Line: " << token.line_number
-                      << ", Column: " << token.col_number << "\n";
-        }
-
-        std::cout << "Tokenization complete\n"
-                  << "file had " << m_line_number << " lines\n";
-#endif
-        m_index = 0;
-        return tokens;
+        return std::nullopt;
     }
 
+    /**
+     * @brief Value of the last INT_LIT token returned by next_token()
+     */
+    [[nodiscard]] int64_t last_integer() const { return m_integer; }
+
+    /**
+     * @brief Start over at the beginning of the source
+     */
+    void rewind() { m_index = 0; }
+
+    [[nodiscard]] std::string_view source() const { return m_src; }
+
    private:
     [[nodiscard]] std::optional<char> peek(size_t offset = 0) const {
         if (m_index + offset >= m_src.size()) {
@@ -280,22 +262,86 @@ class Tokenizer {
         return m_src[m_index + offset];
     }
 
-    char consume() {
-        m_col_number++;
-        return m_src.at(m_index++);
+    char consume() { return m_src.at(m_index++); }
+
+    [[nodiscard]] const char* cursor() const { return m_src.data() + m_index; }
+
+    [[nodiscard]] const char* end() const {
+        return m_src.data() + m_src.size();
     }
 
-    void handle_new_line() {
-#ifdef DEBUG
-        std::cout << "New line at: " << m_line_number << " with "
-                  << m_col_number << " columns\n";
-#endif
-        m_line_number++;
-        m_col_number = 0;
+    void advance_to(const char* position) {
+        m_index = static_cast<size_t>(position - m_src.data());
+    }
+
+    // Token from `start` up to the cursor
+    [[nodiscard]] Token make_token(const TokenType type, const size_t start,
+                                   const SymbolId symbol = {}) const {
+        return Token{type, static_cast<uint32_t>(start),
+                     static_cast<uint32_t>(m_index - start), symbol};
+    }
+
+    /**
+     * @brief Value of an integer literal with an optional leading `-` and
+     * `_` separators, std::nullopt if it does not fit into 64 bits
+     */
+    static std::optional<int64_t> parse_integer(const std::string_view text) {
+        const bool negative = text.front() == '-';
+
+        // Accumulate the negated value, which also covers INT64_MIN
+        int64_t value = 0;
+        for (const char c : text.substr(negative ? 1 : 0)) {
+            if (c == '_') continue;
+
+            if (__builtin_mul_overflow(value, 10, &value) ||
+                __builtin_sub_overflow(value, c - '0', &value)) {
+                return std::nullopt;
+            }
+        }
+
+        if (negative) return value;
+        if (value == std::numeric_limits<int64_t>::min()) return std::nullopt;
+        return -value;
+    }
+
+    // Token type of the single character operators, braces and `;`
+    static std::optional<TokenType> punctuation_type(const char c) {
+        switch (c) {
+            case '(':
+                return TokenType::OPEN_PAREN;
+            case ')':
+                return TokenType::CLOSE_PAREN;
+            case '=':
+                return TokenType::EQ;
+            case '+':
+                return TokenType::PLUS;
+            case '-':
+                return TokenType::MINUS;
+            case '*':
+                return TokenType::STAR;
+            case '/':
+                return TokenType::FORWARD_SLASH;
+
+            // Braces
+            case '{':
+                return TokenType::OPEN_CURLY;
+            case '}':
+                return TokenType::CLOSE_CURLY;
+
+            // Semicolon, end of line
+            case ';':
+                return TokenType::END_OF_LINE;
+
+            default:
+                return std::nullopt;
+        }
     }
 
-    const std::string m_src;
+    const std::string_view m_src;
+    Interner& m_interner;
+    // Scanning kernels for the instruction set picked at construction
+    const scan::Kernels& m_scan;
     size_t m_index{0};
-    size_t m_col_number{0};
-    size_t m_line_number{1};
+    // Value of the last integer literal lexed
+    int64_t m_integer{0};
 };
\ No newline at end of file
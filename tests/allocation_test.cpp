@@ -0,0 +1,114 @@
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+#include "check.hh"
+#include "parser.hh"
+
+// Parsing allocates nothing per token: the only heap allocations that grow
+// with the program are the chunks of the arena, whose number grows with the
+// logarithm of its size. Neither does the value of an integer literal outlive
+// the parser's lookahead window. Every allocation of the test is counted.
+
+namespace {
+size_t allocation_count = 0;
+}  // namespace
+
+void* operator new(const size_t size) {
+    allocation_count++;
+    if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+
+void operator delete(void* pointer, size_t) noexcept { std::free(pointer); }
+
+namespace {
+struct Parsed {
+    size_t allocations;  // Made by parse_prog(), besides the arena chunks
+    size_t chunks;       // Added to the arena by parse_prog()
+};
+
+// `check` is handed the parsed program
+template <typename Check>
+Parsed parse(const std::string& src, const Check& check) {
+    Interner interner;
+    Parser parser(Tokenizer(src, interner));
+    const size_t chunks_before = parser.arena_stats().chunks;
+    const size_t allocations_before = allocation_count;
+    std::optional<node::Prog> prog = parser.parse_prog();
+    const size_t allocations = allocation_count - allocations_before;
+    if (check::expect(prog.has_value(), "parses")) {
+        check(prog.value());
+    }
+
+    const size_t chunks = parser.arena_stats().chunks - chunks_before;
+    return {allocations - chunks, chunks};
+}
+
+std::string repeat(const std::string_view part, const size_t times) {
+    std::string result;
+    for (size_t i = 0; i < times; i++) {
+        result += part;
+    }
+    return result;
+}
+
+void statements() {
+    constexpr std::string_view statement =
+        "let x = y + z * (w - y);\n{ print(x); }\nif (x) { x = z; }\n";
+    const auto ignore = [](node::Prog&) {};
+    const Parsed small = parse(repeat(statement, 1'000), ignore);
+    const Parsed large = parse(repeat(statement, 10'000), ignore);
+    std::cout << "statements: " << small.allocations << " and "
+              << large.allocations << " allocations, " << small.chunks
+              << " and " << large.chunks << " arena chunks\n";
+    check::expect(small.allocations == large.allocations,
+                  "allocates the same for 10 times the statements");
+}
+
+// `print(0); print(1000003); ...`, one distinct literal per statement
+std::string literals(const size_t count) {
+    std::string src;
+    for (size_t i = 0; i < count; i++) {
+        src += "print(" + std::to_string(i * 1'000'003) + ");\n";
+    }
+    return src;
+}
+
+void integer_literals() {
+    const auto values = [](const size_t count) {
+        return [count](node::Prog& prog) {
+            size_t literal_count = 0;
+            bool in_order = true;
+            for (node::ExprId id = 0; id < prog.expressions.size(); id++) {
+                const node::Expr& expr = prog.expressions[id];
+                if (expr.kind != node::ExprKind::IntLit) continue;
+                in_order = in_order && expr.value == static_cast<int64_t>(
+                                                         literal_count *
+                                                         1'000'003);
+                literal_count++;
+            }
+            check::expect(literal_count == count && in_order,
+                          "keeps the value of every literal");
+        };
+    };
+    const Parsed small = parse(literals(10'000), values(10'000));
+    const Parsed large = parse(literals(100'000), values(100'000));
+    std::cout << "integer literals: " << small.allocations << " and "
+              << large.allocations << " allocations, " << small.chunks
+              << " and " << large.chunks << " arena chunks\n";
+    check::expect(small.allocations == large.allocations,
+                  "allocates the same for 10 times the literals");
+}
+}  // namespace
+
+int main() {
+    statements();
+    integer_literals();
+    return check::result();
+}
\ No newline at end of file
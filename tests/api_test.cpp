@@ -0,0 +1,138 @@
+#include <exception>
+#include <source_location>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "check.hh"
+#include "cmm.hh"
+
+// Tests of cmm::compile(): every malformed program has to come back as a
+// diagnostic, with no other exception escaping, whichever stage finds it and
+// however many threads compile at once.
+
+namespace {
+std::string describe(const std::string_view src) {
+    return "`" + std::string(src) + "`";
+}
+
+void expect_diagnostic(const std::string_view src, const ErrorCode code,
+                       const size_t line, const size_t column,
+                       const std::source_location location =
+                           std::source_location::current()) {
+    cmm::Result result;
+    try {
+        result = cmm::compile(src);
+    } catch (const std::exception& exception) {
+        check::expect(false,
+                      describe(src) + " throws " + exception.what(), location);
+        return;
+    }
+
+    if (!check::expect(result.diagnostics.size() == 1,
+                       describe(src) + " has one diagnostic", location)) {
+        return;
+    }
+    const cmm::Diagnostic& diagnostic = result.diagnostics.front();
+    check::expect(diagnostic.code == code,
+                  describe(src) + " reports " + diagnostic.message, location);
+    check::expect(diagnostic.line == line && diagnostic.column == column,
+                  describe(src) + " reports at " +
+                      std::to_string(diagnostic.line) + ":" +
+                      std::to_string(diagnostic.column),
+                  location);
+}
+
+void lexer_errors() {
+    // A `-` at the end of the source is the operator, not a number
+    expect_diagnostic("let x = 1 -", ErrorCode::ExpectedExpression, 1, 12);
+    expect_diagnostic("exit(1);\n-", ErrorCode::InvalidProgram, 2, 1);
+
+    expect_diagnostic("print(\"abc);", ErrorCode::UnterminatedString, 1, 7);
+    expect_diagnostic("exit(0);\n\"", ErrorCode::UnterminatedString, 2, 1);
+    expect_diagnostic("print(\"a\");\nprint(\"b);\nexit(0);",
+                      ErrorCode::UnterminatedString, 2, 7);
+
+    // Bytes outside of ASCII
+    expect_diagnostic("let \xe9 = 1;", ErrorCode::UnidentifiedToken, 1, 5);
+}
+
+void parser_errors() {
+    expect_diagnostic("exit(1", ErrorCode::ExpectedCloseParenthesis, 1, 7);
+    expect_diagnostic("let = 1;", ErrorCode::ExpectedIdentifier, 1, 5);
+    expect_diagnostic("if (1) { exit(0);", ErrorCode::ExpectedCloseCurly, 1,
+                      18);
+}
+
+void semantic_errors() {
+    expect_diagnostic("exit(x);", ErrorCode::VariableNotDeclared, 1, 6);
+    expect_diagnostic("let x = 1;\nlet x = 2;",
+                      ErrorCode::VariableAlreadyDeclared, 2, 5);
+    expect_diagnostic("let x = 1;\nx = 2;", ErrorCode::VariableNotMutable, 2,
+                      1);
+    // Found by constant folding
+    expect_diagnostic("exit(1 / 0);", ErrorCode::DivisionByZero, 1, 8);
+}
+
+void concurrent_compiles() {
+    constexpr std::string_view good =
+        "let mut x = 7;\n"
+        "let y = x * 10 / 3;\n"
+        "if (y - 23) { x = y / 7; } elif (x) { print(\"x\"); } "
+        "else { x = 0; }\n"
+        "print(x + y);\n"
+        "exit(x);";
+    // One error of each stage
+    constexpr std::string_view bad[] = {"let \xe9 = 1;", "exit(1",
+                                        "exit(x);", "exit(1 / 0);"};
+    constexpr size_t thread_count = 8;
+    constexpr size_t rounds = 50;
+
+    const cmm::Result reference = cmm::compile(good);
+    if (!check::expect(reference.ok() && !reference.assembly.empty(),
+                       "compiles the program shared by the threads")) {
+        return;
+    }
+
+    // check::expect() is not thread safe, each thread counts its own
+    // failures
+    std::vector<size_t> different(thread_count, 0);
+    std::vector<size_t> unreported(thread_count, 0);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < thread_count; t++) {
+        threads.emplace_back([&, t] {
+            for (size_t round = 0; round < rounds; round++) {
+                const cmm::Result result = cmm::compile(good);
+                if (!result.ok() || result.assembly != reference.assembly) {
+                    different[t]++;
+                }
+                const std::string_view src = bad[(t + round) % std::size(bad)];
+                if (cmm::compile(src).diagnostics.empty()) {
+                    unreported[t]++;
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    for (size_t t = 0; t < thread_count; t++) {
+        check::expect(different[t] == 0,
+                      "thread " + std::to_string(t) +
+                          " compiles the same assembly every time");
+        check::expect(unreported[t] == 0,
+                      "thread " + std::to_string(t) +
+                          " gets a diagnostic for every malformed program");
+    }
+}
+}  // namespace
+
+int main() {
+    lexer_errors();
+    parser_errors();
+    semantic_errors();
+    concurrent_compiles();
+    return check::result();
+}
\ No newline at end of file
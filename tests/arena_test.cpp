@@ -0,0 +1,133 @@
+#include <cstdint>
+#include <vector>
+
+#include "arena.hh"
+#include "check.hh"
+
+// Objects stay in place while the arena grows, the destructors registered by
+// emplace() run when the arena is rewound, reset or destroyed, and a rewind
+// hands the chunks it kept to the following allocations.
+
+namespace {
+// Appends its id to `log` when destroyed
+struct Logged {
+    std::vector<int>* log;
+    int id;
+
+    ~Logged() { log->push_back(id); }
+};
+
+void pointer_stability() {
+    ArenaAllocator arena(64);
+    std::vector<int64_t*> pointers;
+    for (int64_t i = 0; i < 10'000; i++) {
+        pointers.push_back(arena.emplace<int64_t>(i));
+    }
+    check::expect(arena.stats().chunks > 1, "grows into several chunks");
+
+    bool kept = true;
+    for (int64_t i = 0; i < 10'000; i++) {
+        kept = kept && *pointers[static_cast<size_t>(i)] == i;
+    }
+    check::expect(kept, "keeps every object in place while growing");
+}
+
+void destructors() {
+    std::vector<int> log;
+    {
+        // Small enough that the objects and destructors span several chunks
+        ArenaAllocator arena(64);
+        for (int id = 0; id < 2; id++) {
+            (void)arena.emplace<Logged>(&log, id);
+        }
+
+        const ArenaAllocator::Mark mark = arena.mark();
+        for (int id = 2; id < 10; id++) {
+            (void)arena.emplace<Logged>(&log, id);
+        }
+        arena.rewind(mark);
+        check::expect(log == std::vector{9, 8, 7, 6, 5, 4, 3, 2},
+                      "rewind destroys what followed the mark, newest first");
+
+        arena.reset();
+        check::expect(log == std::vector{9, 8, 7, 6, 5, 4, 3, 2, 1, 0},
+                      "reset destroys everything left");
+
+        log.clear();
+        for (int id = 10; id < 13; id++) {
+            (void)arena.emplace<Logged>(&log, id);
+        }
+        // Trivially destructible objects register nothing
+        (void)arena.emplace<int64_t>(0);
+        check::expect(log.empty(), "destroys nothing while allocating");
+    }
+    check::expect(log == std::vector{12, 11, 10},
+                  "the destruction of the arena destroys everything");
+}
+
+void chunk_reuse() {
+    ArenaAllocator arena(64);
+    const ArenaAllocator::Mark mark = arena.mark();
+    const int64_t* first = arena.emplace<int64_t>(1);
+    for (int64_t i = 0; i < 1'000; i++) {
+        (void)arena.emplace<int64_t>(i);
+    }
+    const ArenaAllocator::Stats grown = arena.stats();
+
+    for (int round = 0; round < 3; round++) {
+        arena.rewind(mark);
+        check::expect(arena.stats().bytes_used == 0,
+                      "rewind gives the bytes back");
+        check::expect(arena.emplace<int64_t>(1) == first,
+                      "allocates from the start again after a rewind");
+        for (int64_t i = 0; i < 1'000; i++) {
+            (void)arena.emplace<int64_t>(i);
+        }
+        const ArenaAllocator::Stats stats = arena.stats();
+        check::expect(stats.chunks == grown.chunks &&
+                          stats.bytes_reserved == grown.bytes_reserved,
+                      "reuses the chunks after a rewind");
+    }
+
+    arena.reset();
+    for (int64_t i = 0; i < 1'001; i++) {
+        (void)arena.emplace<int64_t>(i);
+    }
+    check::expect(arena.stats().chunks == grown.chunks,
+                  "reuses the chunks after a reset");
+}
+
+void stats() {
+    ArenaAllocator arena(256);
+    // Offsets 0, 8 (after 7 bytes of padding), 16, 20 (after 3), 24 and
+    // 32 (after 6)
+    (void)arena.alloc_array<char>(1);
+    (void)arena.alloc_array<int64_t>(1);
+    (void)arena.alloc_array<char>(1);
+    (void)arena.alloc_array<int32_t>(1);
+    (void)arena.alloc_array<int16_t>(1);
+    (void)arena.alloc_array<int64_t>(1);
+
+    const ArenaAllocator::Stats stats = arena.stats();
+    check::expect(stats.bytes_used == 24, "counts the bytes handed out");
+    check::expect(stats.padding == 16, "counts the padding");
+    check::expect(stats.bytes_reserved == 256 && stats.chunks == 1,
+                  "fits in the first chunk");
+
+    const ArenaAllocator::Mark mark = arena.mark();
+    (void)arena.alloc_array<char>(3);
+    (void)arena.alloc_array<int64_t>(2);
+    arena.rewind(mark);
+    check::expect(arena.stats().bytes_used == 24 &&
+                      arena.stats().padding == 16,
+                  "rewind restores the counts of the mark");
+}
+}  // namespace
+
+int main() {
+    pointer_stability();
+    destructors();
+    chunk_reuse();
+    stats();
+    return check::result();
+}
\ No newline at end of file
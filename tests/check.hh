@@ -0,0 +1,38 @@
+#pragma once
+
+#include <iostream>
+#include <source_location>
+#include <string_view>
+
+// Checks shared by the tests in tests/. Every test is an executable that
+// ctest runs, it reports each failed check and exits with a non-zero status
+// if there was one.
+namespace check {
+
+inline int failures = 0;
+
+/**
+ * @brief Report a failure at the caller if `condition` does not hold,
+ * `what` describes the check. Returns `condition`.
+ */
+inline bool expect(const bool condition, const std::string_view what,
+                   const std::source_location location =
+                       std::source_location::current()) {
+    if (!condition) {
+        failures++;
+        std::cerr << location.file_name() << ":" << location.line()
+                  << ": check failed: " << what << "\n";
+    }
+    return condition;
+}
+
+/**
+ * @brief Exit status of the test
+ */
+inline int result() {
+    if (failures > 0) {
+        std::cerr << failures << " checks failed\n";
+    }
+    return failures > 0 ? 1 : 0;
+}
+}  // namespace check
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include <initializer_list>
+#include <string>
+#include <string_view>
+
+#include "check.hh"
+#include "cmm.hh"
+#include "generation.hh"
+#include "ir.hh"
+
+// Printed output has to come out in program order whichever prints end up as
+// buffered text, and the text printed before a division that traps has to
+// be written out before it.
+
+namespace {
+// Whether `parts` appear in `assembly` in this order
+bool in_order(const std::string_view assembly,
+              const std::initializer_list<std::string_view> parts) {
+    size_t position = 0;
+    for (const std::string_view part : parts) {
+        position = assembly.find(part, position);
+        if (position == std::string_view::npos) {
+            return false;
+        }
+        position += part.size();
+    }
+    return true;
+}
+
+void constant_before_runtime_value() {
+    // The propagated value of x joins the text of print(3)
+    const cmm::Result result =
+        cmm::compile("let mut x = 1; x = 2; print(3); print(x);");
+    check::expect(result.ok() && in_order(result.assembly, {"'3', 10, '2'"}),
+                  "prints 3 then 2");
+
+    // Without propagation, x is printed at runtime after the text
+    ir::Program program;
+    program.slot_count = 1;
+    const ir::Reg x = program.new_reg();
+    ir::Block block;
+    block.insts.push_back(ir::Inst::print_text(program.add_text("3\n")));
+    block.insts.push_back(ir::Inst::load(x, 0));
+    block.insts.push_back(ir::Inst::print_int(ir::Operand::of_reg(x)));
+    program.blocks.push_back(block);
+    const std::string assembly = Generator(std::move(program)).gen_prog();
+    check::expect(in_order(assembly,
+                           {"call check_and_add_to_buffer",
+                            "call write_buffer", "call print_int"}),
+                  "writes the buffer out before print_int");
+}
+
+void text_before_trap() {
+    const cmm::Result result =
+        cmm::compile("let z = 0; print(1); exit(1 / z);");
+    check::expect(result.ok() && in_order(result.assembly,
+                                          {"call check_and_add_to_buffer",
+                                           "call write_buffer", "idiv"}),
+                  "writes the buffer out before a division by 0");
+
+    const cmm::Result minimum = cmm::compile(
+        "let m = -9223372036854775807 - 1; print(1); exit(m / -1);");
+    check::expect(minimum.ok() && in_order(minimum.assembly,
+                                           {"call check_and_add_to_buffer",
+                                            "call write_buffer", "idiv"}),
+                  "writes the buffer out before INT64_MIN / -1");
+}
+}  // namespace
+
+int main() {
+    constant_before_runtime_value();
+    text_before_trap();
+    return check::result();
+}
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "check.hh"
+#include "tokenization.hh"
+
+// Differential test of the scan kernels: the SSE2 and AVX2 tokenizers have to
+// produce the same tokens, or fail with the same error at the same place, as
+// the scalar one.
+
+namespace {
+struct Lexed {
+    std::vector<Token> tokens;
+    std::vector<int64_t> integers;  // Of the INT_LIT tokens, in order
+    // Code and offset of the error that ended lexing, if any
+    std::optional<ErrorCode> error;
+    size_t line{0};
+    size_t column{0};
+    bool other_exception{false};
+
+    bool operator==(const Lexed& other) const {
+        if (tokens.size() != other.tokens.size()) return false;
+        for (size_t i = 0; i < tokens.size(); i++) {
+            const Token& left = tokens[i];
+            const Token& right = other.tokens[i];
+            if (left.type != right.type || left.offset != right.offset ||
+                left.length != right.length ||
+                (left.type == TokenType::IDENT &&
+                 left.symbol != right.symbol)) {
+                return false;
+            }
+        }
+        return integers == other.integers && error == other.error &&
+               line == other.line && column == other.column &&
+               other_exception == other.other_exception;
+    }
+};
+
+Lexed lex(const std::string_view src, const scan::Isa isa) {
+    Lexed lexed;
+    Interner interner;
+    Tokenizer tokenizer(src, interner, isa);
+    try {
+        while (const std::optional<Token> token = tokenizer.next_token()) {
+            lexed.tokens.push_back(token.value());
+            if (token->type == TokenType::INT_LIT) {
+                lexed.integers.push_back(tokenizer.last_integer());
+            }
+        }
+    } catch (const CompileError& error) {
+        lexed.error = error.code;
+        lexed.line = error.line;
+        lexed.column = error.column;
+    } catch (const std::exception&) {
+        lexed.other_exception = true;
+    }
+    return lexed;
+}
+
+std::vector<scan::Isa> vector_isas() {
+    std::vector<scan::Isa> isas;
+#if defined(__x86_64__)
+    isas.push_back(scan::Isa::Sse2);
+    if (__builtin_cpu_supports("avx2")) {
+        isas.push_back(scan::Isa::Avx2);
+    }
+#endif
+    return isas;
+}
+
+void compare(const std::string_view src) {
+    const Lexed scalar = lex(src, scan::Isa::Scalar);
+    for (const scan::Isa isa : vector_isas()) {
+        if (!check::expect(lex(src, isa) == scalar,
+                           "tokens differ from the scalar kernels")) {
+            std::cerr << "isa " << static_cast<int>(isa) << ", source `"
+                      << src << "`\n";
+        }
+    }
+}
+
+// Runs of one kind of character whose ends fall on every position around
+// the 16 and 32 byte blocks
+void compare_boundaries() {
+    const std::string_view runs[] = {
+        " ", "\t\n", "a", "Z9", "7", "1_0", "x",
+    };
+    const std::string_view ends[] = {
+        "",         "+",     ";",      "//c",   "/*c*/",  "/* open",
+        "// open",  "\"s\"", "\"open", "\x80",  "-",      "\xff a",
+        "*/",       "**/",   "/",      "\"\\\"", "-1",    "-",
+    };
+    for (const std::string_view run : runs) {
+        for (size_t length = 0; length <= 70; length++) {
+            std::string body;
+            while (body.size() < length) body += run;
+            body.resize(length);
+
+            for (const std::string_view end : ends) {
+                for (const std::string_view start :
+                     {"", "x", "\"", "/*", "//"}) {
+                    compare(std::string(start) + body + std::string(end));
+                }
+            }
+        }
+    }
+}
+
+// Comment terminators and quotes at every position in and around a block
+void compare_terminators() {
+    for (size_t position = 0; position <= 70; position++) {
+        for (const std::string_view terminator : {"*/", "\"", "\n", "*"}) {
+            std::string comment(position, 'c');
+            compare("/*" + comment + std::string(terminator) + " 1");
+            compare("//" + comment + std::string(terminator) + "1");
+            compare("\"" + comment + std::string(terminator) + "x");
+        }
+    }
+}
+
+void compare_random() {
+    constexpr std::string_view alphabet[] = {
+        " ",  "\n", "\t", "a",  "z",  "Q",    "0",   "9",  "_",    "-",
+        "+",  "*",  "/",  "(",  ")",  ";",    "{",   "}",  "=",    "\"",
+        "\\", "n",  "//", "/*", "*/", "\x80", "\xff", "let", "mut", "if",
+    };
+    std::mt19937 random(2024);
+    for (int i = 0; i < 20000; i++) {
+        const size_t pieces = random() % 80;
+        std::string src;
+        for (size_t piece = 0; piece < pieces; piece++) {
+            src += alphabet[random() % std::size(alphabet)];
+        }
+        compare(src);
+    }
+}
+}  // namespace
+
+int main() {
+    compare_boundaries();
+    compare_terminators();
+    compare_random();
+    return check::result();
+}
\ No newline at end of file
@@ -0,0 +1,330 @@
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "check.hh"
+#include "strength.hh"
+
+// Runs the instruction sequences emitted for a multiplication or a division
+// by a constant on a small emulator of the x86-64 instructions they use, and
+// compares the results with the exact ones for every class of constant.
+
+namespace {
+constexpr int64_t min = std::numeric_limits<int64_t>::min();
+constexpr int64_t max = std::numeric_limits<int64_t>::max();
+
+constexpr std::string_view register_names[] = {
+    "rax", "rbx", "rcx", "rdx", "rsi", "rdi", "rbp", "r8",
+    "r9",  "r10", "r11", "r12", "r13", "r14", "r15"};
+constexpr size_t register_count = std::size(register_names);
+
+std::optional<size_t> register_index(const std::string_view name) {
+    for (size_t i = 0; i < register_count; i++) {
+        if (register_names[i] == name) return i;
+    }
+    return std::nullopt;
+}
+
+struct Operand {
+    std::optional<size_t> reg;  // Immediate if empty
+    int64_t imm{0};
+};
+
+enum class Op { Mov, Add, Sub, Xor, Neg, Imul, Lea, Shl, Shr, Sar };
+
+constexpr std::pair<std::string_view, Op> mnemonics[] = {
+    {"mov", Op::Mov}, {"add", Op::Add},   {"sub", Op::Sub}, {"xor", Op::Xor},
+    {"neg", Op::Neg}, {"imul", Op::Imul}, {"lea", Op::Lea}, {"shl", Op::Shl},
+    {"shr", Op::Shr}, {"sar", Op::Sar}};
+
+struct Inst {
+    Op op;
+    std::vector<Operand> operands;
+    // `lea dst, [base + index * scale]` has the operands dst, base, index
+    // and scale
+};
+
+/**
+ * @brief Decode the lines of `assembly`, std::nullopt if one uses an
+ * instruction or an operand the emulator does not know
+ */
+std::optional<std::vector<Inst>> decode(const std::string_view assembly) {
+    std::vector<Inst> program;
+    std::istringstream lines{std::string(assembly)};
+    std::string line;
+    while (std::getline(lines, line)) {
+        const size_t start = line.find_first_not_of(' ');
+        if (start == std::string::npos) continue;
+        const size_t space = line.find(' ', start);
+        const std::string_view mnemonic =
+            std::string_view(line).substr(start, space - start);
+        const auto known = std::find_if(
+            std::begin(mnemonics), std::end(mnemonics),
+            [&](const auto& entry) { return entry.first == mnemonic; });
+        if (known == std::end(mnemonics)) {
+            return std::nullopt;
+        }
+        Inst inst{known->second, {}};
+
+        std::string rest =
+            space == std::string::npos ? "" : line.substr(space + 1);
+        // `[a + b * s]` reads as the operands a, b and s
+        for (const std::string_view noise : {"[", "]", " +", " *"}) {
+            for (size_t at = rest.find(noise); at != std::string::npos;
+                 at = rest.find(noise)) {
+                rest.replace(at, noise.size(), noise == " +" ? "," : " ,");
+            }
+        }
+
+        std::istringstream fields(rest);
+        std::string field;
+        while (std::getline(fields, field, ',')) {
+            const size_t first = field.find_first_not_of(' ');
+            if (first == std::string::npos) continue;
+            const std::string_view text = std::string_view(field).substr(
+                first, field.find_last_not_of(' ') - first + 1);
+
+            Operand operand;
+            operand.reg = register_index(text);
+            if (!operand.reg.has_value()) {
+                const auto [end, error] = std::from_chars(
+                    text.data(), text.data() + text.size(), operand.imm);
+                if (error != std::errc{} || end != text.data() + text.size()) {
+                    return std::nullopt;
+                }
+            }
+            inst.operands.push_back(operand);
+        }
+        program.push_back(std::move(inst));
+    }
+    return program;
+}
+
+struct Machine {
+    uint64_t registers[register_count];
+
+    explicit Machine(const uint64_t garbage) {
+        // The sequences may not rely on any register they do not write
+        for (uint64_t& reg : registers) reg = garbage;
+    }
+
+    [[nodiscard]] uint64_t value(const Operand& operand) const {
+        return operand.reg.has_value() ? registers[operand.reg.value()]
+                                       : static_cast<uint64_t>(operand.imm);
+    }
+
+    // False on operands that do not fit the instruction
+    bool run(const std::vector<Inst>& program) {
+        for (const Inst& inst : program) {
+            if (!step(inst)) return false;
+        }
+        return true;
+    }
+
+    bool step(const Inst& inst) {
+        const std::vector<Operand>& operands = inst.operands;
+        const Op op = inst.op;
+        if (operands.empty() || !operands[0].reg.has_value()) return false;
+        uint64_t& dst = registers[operands[0].reg.value()];
+
+        if (operands.size() == 1) {
+            if (op == Op::Neg) {
+                dst = 0 - dst;
+            } else if (op == Op::Imul) {
+                // rdx:rax = rax * operand, signed
+                const __int128 product =
+                    static_cast<__int128>(static_cast<int64_t>(registers[0])) *
+                    static_cast<int64_t>(dst);
+                registers[0] = static_cast<uint64_t>(product);
+                registers[3] = static_cast<uint64_t>(product >> 64);
+            } else {
+                return false;
+            }
+            return true;
+        }
+
+        const uint64_t source = value(operands[1]);
+        if (operands.size() == 3 && op == Op::Imul) {
+            dst = source * value(operands[2]);
+        } else if (operands.size() == 4 && op == Op::Lea) {
+            dst = source + value(operands[2]) * value(operands[3]);
+        } else if (operands.size() != 2) {
+            return false;
+        } else if (op == Op::Mov) {
+            dst = source;
+        } else if (op == Op::Add) {
+            dst += source;
+        } else if (op == Op::Sub) {
+            dst -= source;
+        } else if (op == Op::Xor) {
+            dst ^= source;
+        } else if (op == Op::Imul) {
+            dst *= source;
+        } else if (op == Op::Shl) {
+            dst <<= source;
+        } else if (op == Op::Shr) {
+            dst >>= source;
+        } else if (op == Op::Sar) {
+            dst = static_cast<uint64_t>(static_cast<int64_t>(dst) >>
+                                        static_cast<int64_t>(source));
+        } else {
+            return false;
+        }
+        return true;
+    }
+};
+
+std::string describe(const char* what, const int64_t left,
+                     const int64_t right) {
+    return std::to_string(left) + " " + what + " " + std::to_string(right);
+}
+
+// The constants: everything small, powers of two and their neighbours in
+// both signs, the extremes, and random values of every magnitude
+std::vector<int64_t> constants() {
+    std::vector<int64_t> values;
+    for (int64_t value = -1000; value <= 1000; value++) {
+        values.push_back(value);
+    }
+    for (unsigned k = 0; k < 64; k++) {
+        const uint64_t power = uint64_t{1} << k;
+        for (const uint64_t near : {power - 1, power, power + 1}) {
+            values.push_back(static_cast<int64_t>(near));
+            values.push_back(static_cast<int64_t>(0 - near));
+        }
+        for (const uint64_t scale : {3, 5, 9}) {
+            values.push_back(static_cast<int64_t>(scale << k));
+            values.push_back(static_cast<int64_t>(0 - (scale << k)));
+        }
+    }
+    for (const int64_t value : {min, min + 1, max, max - 1}) {
+        values.push_back(value);
+    }
+
+    std::mt19937_64 random(20);
+    for (int i = 0; i < 1000; i++) {
+        values.push_back(static_cast<int64_t>(random() >> (random() % 64)));
+        values.push_back(static_cast<int64_t>(random()));
+    }
+    return values;
+}
+
+// The operands tried with every constant, to which the divisions add the
+// values around multiples of the divisor, where rounding goes wrong first
+std::vector<int64_t> operands() {
+    std::vector<int64_t> values;
+    for (int64_t value = -64; value <= 64; value++) {
+        values.push_back(value);
+    }
+    for (unsigned k = 6; k < 64; k++) {
+        const uint64_t power = uint64_t{1} << k;
+        for (const uint64_t near : {power - 1, power, power + 1}) {
+            values.push_back(static_cast<int64_t>(near));
+            values.push_back(static_cast<int64_t>(0 - near));
+        }
+    }
+    for (const int64_t value : {min, min + 1, max, max - 1}) {
+        values.push_back(value);
+    }
+
+    std::mt19937_64 random(64);
+    for (int i = 0; i < 32; i++) {
+        values.push_back(static_cast<int64_t>(random()));
+    }
+    return values;
+}
+
+void check_multiplication(const int64_t factor,
+                          const std::vector<int64_t>& factors) {
+    // Both the accumulator and another register hold the product
+    for (const std::string_view reg : {"rax", "r12"}) {
+        std::ostringstream assembly;
+        strength::gen_mul_by_constant(assembly, reg, factor);
+        const std::optional<std::vector<Inst>> program =
+            decode(assembly.str());
+        if (!check::expect(program.has_value(),
+                           "decodes " + describe("*", 0, factor))) {
+            return;
+        }
+
+        const size_t result = register_index(reg).value();
+        for (const int64_t x : factors) {
+            Machine machine(0x5a5a5a5a5a5a5a5a);
+            machine.registers[result] = static_cast<uint64_t>(x);
+            // The low 64 bits of the product, which wraps like `imul`
+            const uint64_t expected =
+                static_cast<uint64_t>(x) * static_cast<uint64_t>(factor);
+            // Messages are only built for a failure, as there are millions
+            // of checks
+            if (!machine.run(program.value()) ||
+                machine.registers[result] != expected) {
+                check::expect(false, describe("*", x, factor));
+                return;
+            }
+        }
+    }
+}
+
+void check_division(const int64_t divisor,
+                    const std::vector<int64_t>& dividends) {
+    // The Generator leaves these to `idiv`, so that a division by 0 and
+    // INT64_MIN / -1 trap
+    if (divisor == 0 || divisor == -1) {
+        check::expect(!strength::reduces_division(divisor),
+                      "keeps `idiv` for " + describe("/", 1, divisor));
+        return;
+    }
+    if (!check::expect(strength::reduces_division(divisor),
+                       "reduces " + describe("/", 1, divisor))) {
+        return;
+    }
+
+    std::ostringstream assembly;
+    strength::gen_div_by_constant(assembly, divisor);
+    const std::optional<std::vector<Inst>> program = decode(assembly.str());
+    if (!check::expect(program.has_value(),
+                       "decodes " + describe("/", 0, divisor))) {
+        return;
+    }
+
+    std::vector<int64_t> values = dividends;
+    for (const int64_t quotient :
+         {max / divisor, min / divisor, int64_t{1}, int64_t{-1}, int64_t{7},
+          int64_t{-7}}) {
+        for (const int delta : {-1, 0, 1}) {
+            const __int128 value =
+                static_cast<__int128>(quotient) * divisor + delta;
+            if (value >= min && value <= max) {
+                values.push_back(static_cast<int64_t>(value));
+            }
+        }
+    }
+
+    for (const int64_t x : values) {
+        Machine machine(0xa5a5a5a5a5a5a5a5);
+        machine.registers[0] = static_cast<uint64_t>(x);
+        if (!machine.run(program.value()) ||
+            static_cast<int64_t>(machine.registers[0]) != x / divisor) {
+            check::expect(false, describe("/", x, divisor));
+            return;
+        }
+    }
+}
+}  // namespace
+
+int main() {
+    const std::vector<int64_t> values = operands();
+    for (const int64_t constant : constants()) {
+        check_multiplication(constant, values);
+        check_division(constant, values);
+    }
+    return check::result();
+}
\ No newline at end of file